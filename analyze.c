@@ -7,12 +7,15 @@
 /****************************************************/
 
 #include "globals.h"
+#include "util.h"
 #include "symtab.h"
 #include "analyze.h"
 
 /* counter for variable memory locations */
 static int location = 0;
 
+static void typeError(TreeNode *t, char *message);
+
 /* Procedure traverse is a generic recursive
  * syntax tree traversal routine:
  * it applies preProc in preorder and postProc
@@ -49,6 +52,40 @@ static void nullProc(TreeNode *t)
         return;
 }
 
+/* parameter types of the built-in functions
+ * int input(void) and void output(int)
+ */
+static const unsigned char outputParams[] = {Integer};
+
+/* Procedure insertBuiltins enters the run-time
+ * I/O functions into the symbol table
+ */
+static void insertBuiltins(void)
+{
+    st_insert("input", 0, location++, FUNC);
+    st_set_signature("input", Integer, 0, NULL, FALSE);
+    st_insert("output", 0, location++, FUNC);
+    st_set_signature("output", Void, 1, outputParams, FALSE);
+}
+
+/* Procedure insertSignature records the return
+ * and parameter types of function declaration t
+ */
+static void insertSignature(TreeNode *t)
+{
+    int n = paramCount(t->child[0]);
+    unsigned char *ptypes = NULL;
+    TreeNode *p;
+    int i = 0;
+    if (n > 0)
+    {
+        ptypes = malloc(n);
+        for (p = t->child[0]; p != NULL; p = p->sibling)
+            ptypes[i++] = (unsigned char)p->type;
+    }
+    st_set_signature(t->attr.name, t->type, n, ptypes, FALSE);
+}
+
 /* Procedure insertNode inserts
  * identifiers stored in t into
  * the symbol table
@@ -78,6 +115,7 @@ static void insertNode(TreeNode *t)
             } else {
                 st_insert(t->attr.name, t->lineno, 0, FUNC);
             }
+            insertSignature(t);
             break;
         case ReturnK:
             break;
@@ -115,13 +153,129 @@ static void insertNode(TreeNode *t)
     }
 }
 
+/* the stack of declarations currently in scope,
+ * used to bind each name to its declaration
+ */
+static TreeNode **scopeDecls = NULL;
+static int nScopeDecls = 0;
+static int maxScopeDecls = 0;
+static int scopeDepth = 0;
+
+static void declare(TreeNode *t)
+{
+    t->scope = scopeDepth;
+    if (nScopeDecls == maxScopeDecls)
+    {
+        maxScopeDecls = maxScopeDecls == 0 ? 256 : 2 * maxScopeDecls;
+        scopeDecls = realloc(scopeDecls, maxScopeDecls * sizeof(TreeNode *));
+    }
+    scopeDecls[nScopeDecls++] = t;
+}
+
+static TreeNode *lookupDecl(char *name, int wantFunc)
+{
+    int i;
+    for (i = nScopeDecls - 1; i >= 0; i--)
+        if (strcmp(scopeDecls[i]->attr.name, name) == 0 &&
+            (scopeDecls[i]->nodekind == StmtK &&
+             scopeDecls[i]->kind.stmt == FuncDeclarationK) == wantFunc)
+            return scopeDecls[i];
+    return NULL;
+}
+
+/* Procedure bindNode binds the names used at t to
+ * their declarations (in preorder); a scope is
+ * opened for the parameters of each function and
+ * for each compound statement
+ */
+static void bindNode(TreeNode *t)
+{
+    if (t->nodekind == StmtK)
+    {
+        switch (t->kind.stmt)
+        {
+        case FuncDeclarationK:
+        case CompoundK:
+            scopeDepth++;
+            break;
+        case VarDeclarationK:
+            if (scopeDepth > 0)
+                declare(t);
+            break;
+        case AssignK:
+            t->decl = lookupDecl(t->attr.name, FALSE);
+            if (t->decl == NULL && st_imported(t->attr.name))
+                typeError(t, "assignment to a variable of another module");
+            else if (t->decl == NULL)
+                typeError(t, "assignment to undeclared variable");
+            break;
+        default:
+            break;
+        }
+    }
+    else
+    {
+        switch (t->kind.exp)
+        {
+        case ParamK:
+            if (t->type != Void)
+                declare(t);
+            break;
+        case IdK:
+            t->decl = lookupDecl(t->attr.name, FALSE);
+            if (t->decl == NULL && st_imported(t->attr.name))
+                typeError(t, "use of a variable of another module");
+            else if (t->decl == NULL)
+                typeError(t, "use of undeclared variable");
+            break;
+        case CallK:
+            t->decl = lookupDecl(t->attr.name, TRUE);
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+/* Procedure unbindNode closes the scope opened
+ * by bindNode at t (in postorder)
+ */
+static void unbindNode(TreeNode *t)
+{
+    if (t->nodekind == StmtK &&
+        (t->kind.stmt == FuncDeclarationK || t->kind.stmt == CompoundK))
+    {
+        scopeDepth--;
+        while (nScopeDecls > 0 && scopeDecls[nScopeDecls - 1]->scope > scopeDepth)
+            nScopeDecls--;
+    }
+}
+
+/* Procedure bindNames binds every name in the
+ * syntax tree to its declaration; functions and
+ * global variables are visible in the whole file
+ */
+static void bindNames(TreeNode *syntaxTree)
+{
+    TreeNode *t;
+    nScopeDecls = 0;
+    scopeDepth = 0;
+    for (t = syntaxTree; t != NULL; t = t->sibling)
+        if (t->nodekind == StmtK &&
+            (t->kind.stmt == FuncDeclarationK || t->kind.stmt == VarDeclarationK))
+            declare(t);
+    traverse(syntaxTree, bindNode, unbindNode);
+}
+
 /* Function buildSymtab constructs the symbol
  * table by preorder traversal of the syntax tree
  */
 // 前序遍历语法树来构造符号表
 void buildSymtab(TreeNode *syntaxTree)
 {
+    insertBuiltins();
     traverse(syntaxTree, insertNode, nullProc);
+    bindNames(syntaxTree);
     if (TraceAnalyze)
     {
         fprintf(listing, "\nSymbol table:\n\n");
@@ -135,6 +289,31 @@ static void typeError(TreeNode *t, char *message)
     Error = TRUE;
 }
 
+/* Procedure checkCall checks the arguments of
+ * call t against the signature of the callee
+ * and gives the call the callee's return type
+ */
+static void checkCall(TreeNode *t)
+{
+    int rettype, nparams, nargs = 0;
+    const unsigned char *ptypes;
+    TreeNode *a;
+    if (!st_signature(t->attr.name, &rettype, &nparams, &ptypes))
+    {
+        typeError(t, "call to undeclared function");
+        return;
+    }
+    for (a = t->child[0]; a != NULL; a = a->sibling)
+    {
+        if (nargs < nparams && a->type != ptypes[nargs])
+            typeError(a, "argument type does not match parameter");
+        nargs++;
+    }
+    if (nargs != nparams)
+        typeError(t, "wrong number of arguments in call");
+    t->type = (ExpType)rettype;
+}
+
 /* Procedure checkNode performs
  * type checking at a single tree node
  */
@@ -149,7 +328,9 @@ static void checkNode(TreeNode *t)
             if ((t->child[0]->type != Integer) ||
                 (t->child[1]->type != Integer))
                 typeError(t, "Op applied to non-integer");
-            if ((t->attr.op == EQ) || (t->attr.op == LT))
+            if ((t->attr.op == EQ) || (t->attr.op == NE) ||
+                (t->attr.op == LT) || (t->attr.op == LE) ||
+                (t->attr.op == RT) || (t->attr.op == RE))
                 t->type = Boolean;
             else
                 t->type = Integer;
@@ -158,6 +339,9 @@ static void checkNode(TreeNode *t)
         case IdK: // id 视为 int，便于检查
             t->type = Integer;
             break;
+        case CallK:
+            checkCall(t);
+            break;
         default:
             break;
         }
@@ -170,8 +354,8 @@ static void checkNode(TreeNode *t)
                 typeError(t->child[0], "if test is not Boolean");
             break;
         case AssignK:
-            if (t->child[0]->type != Integer && t->child[0]->kind.stmt != CallK)
-                typeError(t->child[0], "assignment of non-integer or non-call value");
+            if (t->child[0]->type != Integer)
+                typeError(t->child[0], "assignment of non-integer value");
             break;
         case WhileK:
             if (t->child[0]->type == Integer)
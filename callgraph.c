@@ -0,0 +1,276 @@
+/****************************************************/
+/* File: callgraph.c                                */
+/* Call graph construction and unreachable-function */
+/* elimination for the C-- compiler                 */
+/****************************************************/
+
+#include "globals.h"
+#include "callgraph.h"
+
+/* the record kept for each declared function:
+ * its declaration, the distinct functions it
+ * calls and whether main can reach it
+ */
+typedef struct
+{
+    TreeNode *decl;
+    int *callees;
+    int ncallees;
+    int maxcallees;
+    int reachable;
+    int recursive;
+    int index, lowlink, onStack; /* for finding cycles */
+} CallGraphRec;
+
+static CallGraphRec *funcs = NULL;
+static int nfuncs = 0;
+static int maxfuncs = 0;
+
+/* the unreachable functions removed so far */
+static int nremoved = 0;
+
+int cg_count(void)
+{
+    return nfuncs;
+}
+
+int cg_lookup(char *name)
+{
+    int i;
+    for (i = 0; i < nfuncs; i++)
+        if (strcmp(funcs[i].decl->attr.name, name) == 0)
+            return i;
+    return -1;
+}
+
+TreeNode *cg_decl(int f)
+{
+    return funcs[f].decl;
+}
+
+int cg_ncallees(int f)
+{
+    return funcs[f].ncallees;
+}
+
+int cg_callee(int f, int i)
+{
+    return funcs[f].callees[i];
+}
+
+int cg_reachable(int f)
+{
+    return funcs[f].reachable;
+}
+
+int cg_recursive(int f)
+{
+    return funcs[f].recursive;
+}
+
+static void addFunction(TreeNode *t)
+{
+    if (nfuncs == maxfuncs)
+    {
+        maxfuncs = maxfuncs ? 2 * maxfuncs : 16;
+        funcs = realloc(funcs, maxfuncs * sizeof(CallGraphRec));
+    }
+    funcs[nfuncs].decl = t;
+    funcs[nfuncs].callees = NULL;
+    funcs[nfuncs].ncallees = 0;
+    funcs[nfuncs].maxcallees = 0;
+    funcs[nfuncs].reachable = FALSE;
+    funcs[nfuncs].recursive = FALSE;
+    funcs[nfuncs].index = -1;
+    nfuncs++;
+}
+
+static void addCallee(int caller, int callee)
+{
+    CallGraphRec *r = &funcs[caller];
+    int i;
+    for (i = 0; i < r->ncallees; i++)
+        if (r->callees[i] == callee)
+            return;
+    if (r->ncallees == r->maxcallees)
+    {
+        r->maxcallees = r->maxcallees ? 2 * r->maxcallees : 4;
+        r->callees = realloc(r->callees, r->maxcallees * sizeof(int));
+    }
+    r->callees[r->ncallees++] = callee;
+}
+
+/* Procedure collectCalls adds an edge from caller
+ * for every CallK node in the tree t; calls to
+ * names that are not declared in this file
+ * (input, output, imported functions) add no edge
+ */
+static void collectCalls(int caller, TreeNode *t)
+{
+    while (t != NULL)
+    {
+        int i;
+        if (t->nodekind == ExpK && t->kind.exp == CallK)
+        {
+            int callee = cg_lookup(t->attr.name);
+            if (callee >= 0)
+                addCallee(caller, callee);
+        }
+        for (i = 0; i < MAXCHILDREN; i++)
+            collectCalls(caller, t->child[i]);
+        t = t->sibling;
+    }
+}
+
+static void markReachable(int f)
+{
+    int i;
+    if (funcs[f].reachable)
+        return;
+    funcs[f].reachable = TRUE;
+    for (i = 0; i < funcs[f].ncallees; i++)
+        markReachable(funcs[f].callees[i]);
+}
+
+/* Tarjan's algorithm: every function in a strongly
+ * connected component of more than one function,
+ * or calling itself, is recursive
+ */
+static int *sccStack = NULL;
+static int sccTop = 0;
+static int sccIndex = 0;
+
+static void findCycles(int f)
+{
+    int i;
+    CallGraphRec *r = &funcs[f];
+    r->index = r->lowlink = sccIndex++;
+    sccStack[sccTop++] = f;
+    r->onStack = TRUE;
+    for (i = 0; i < r->ncallees; i++)
+    {
+        int g = r->callees[i];
+        if (g == f)
+            r->recursive = TRUE;
+        if (funcs[g].index < 0)
+        {
+            findCycles(g);
+            if (funcs[g].lowlink < r->lowlink)
+                r->lowlink = funcs[g].lowlink;
+        }
+        else if (funcs[g].onStack && funcs[g].index < r->lowlink)
+            r->lowlink = funcs[g].index;
+    }
+    if (r->lowlink == r->index)
+    {
+        int g, size = 0;
+        int bottom = sccTop;
+        do
+        {
+            g = sccStack[--bottom];
+            size++;
+        } while (g != f);
+        while (sccTop > bottom)
+        {
+            g = sccStack[--sccTop];
+            funcs[g].onStack = FALSE;
+            if (size > 1)
+                funcs[g].recursive = TRUE;
+        }
+    }
+}
+
+/* Procedure buildCallGraph records every function
+ * declared at the top level of the syntax tree and
+ * the functions each one calls, then marks the
+ * functions reachable from main
+ */
+void buildCallGraph(TreeNode *syntaxTree)
+{
+    TreeNode *t;
+    int f;
+    nfuncs = 0;
+    for (t = syntaxTree; t != NULL; t = t->sibling)
+        if (t->nodekind == StmtK && t->kind.stmt == FuncDeclarationK)
+            addFunction(t);
+    for (f = 0; f < nfuncs; f++)
+        collectCalls(f, funcs[f].decl->child[1]);
+    sccStack = realloc(sccStack, (nfuncs + 1) * sizeof(int));
+    sccTop = sccIndex = 0;
+    for (f = 0; f < nfuncs; f++)
+        if (funcs[f].index < 0)
+            findCycles(f);
+    f = cg_lookup("main");
+    if (f >= 0 && !Relocatable)
+        markReachable(f);
+    else /* a library or an object: every function is an entry */
+        for (f = 0; f < nfuncs; f++)
+            funcs[f].reachable = TRUE;
+    if (TraceAnalyze)
+    {
+        int i;
+        fprintf(listing, "\nCall graph:\n\n");
+        fprintf(listing, "Function       Reachable  Recursive  Calls\n");
+        fprintf(listing, "-------------  ---------  ---------  -----\n");
+        for (f = 0; f < nfuncs; f++)
+        {
+            fprintf(listing, "%-14s %-10s %-10s", funcs[f].decl->attr.name,
+                    funcs[f].reachable ? "yes" : "no",
+                    funcs[f].recursive ? "yes" : "no");
+            for (i = 0; i < funcs[f].ncallees; i++)
+                fprintf(listing, " %s", funcs[funcs[f].callees[i]].decl->attr.name);
+            fprintf(listing, "\n");
+        }
+    }
+}
+
+/* Function pruneCallGraph unlinks the declarations
+ * of unreachable functions from the syntax tree and
+ * returns the (possibly new) head of the tree
+ */
+TreeNode *pruneCallGraph(TreeNode *syntaxTree)
+{
+    TreeNode *head = syntaxTree;
+    TreeNode *prev = NULL;
+    TreeNode *t = syntaxTree;
+    int removed = 0;
+    while (t != NULL)
+    {
+        TreeNode *next = t->sibling;
+        int f = -1;
+        if (t->nodekind == StmtK && t->kind.stmt == FuncDeclarationK)
+            f = cg_lookup(t->attr.name);
+        if (f >= 0 && !funcs[f].reachable)
+        {
+            if (prev == NULL)
+                head = next;
+            else
+                prev->sibling = next;
+            t->sibling = NULL;
+            removed++;
+            if (TraceAnalyze)
+                fprintf(listing, "removing unreachable function %s (line %d)\n",
+                        t->attr.name, t->lineno);
+        }
+        else
+            prev = t;
+        t = next;
+    }
+    nremoved += removed;
+    if (TraceAnalyze)
+        fprintf(listing, "%d of %d functions reachable\n", nfuncs - removed, nfuncs);
+    return head;
+}
+
+/* Procedure printCodeSize writes to the listing
+ * the size of the generated code, instrs TM
+ * instructions, and what pruning left out of it
+ */
+void printCodeSize(int instrs)
+{
+    fprintf(listing, "\nCode size: %d TM instructions", instrs);
+    if (nremoved > 0)
+        fprintf(listing, "; %d unreachable function%s not generated", nremoved,
+                nremoved == 1 ? "" : "s");
+    fprintf(listing, "\n");
+}
@@ -0,0 +1,63 @@
+/****************************************************/
+/* File: callgraph.h                                */
+/* Call graph interface for the C-- compiler        */
+/****************************************************/
+
+#ifndef _CALLGRAPH_H_
+#define _CALLGRAPH_H_
+
+/* Procedure buildCallGraph records every function
+ * declared at the top level of the syntax tree and
+ * the functions each one calls, then marks the
+ * functions reachable from main
+ */
+void buildCallGraph(TreeNode *syntaxTree);
+
+/* Function pruneCallGraph unlinks the declarations
+ * of unreachable functions from the syntax tree and
+ * returns the (possibly new) head of the tree
+ */
+TreeNode *pruneCallGraph(TreeNode *syntaxTree);
+
+/* Procedure printCodeSize writes to the listing
+ * the size of the generated code, instrs TM
+ * instructions, and what pruning left out of it
+ */
+void printCodeSize(int instrs);
+
+/* Function cg_count returns the number of
+ * functions in the call graph
+ */
+int cg_count(void);
+
+/* Function cg_lookup returns the index of the
+ * function called name or -1 if not found
+ */
+int cg_lookup(char *name);
+
+/* Function cg_decl returns the declaration
+ * node of function f
+ */
+TreeNode *cg_decl(int f);
+
+/* Function cg_ncallees returns the number of
+ * distinct functions called by function f
+ */
+int cg_ncallees(int f);
+
+/* Function cg_callee returns the index of the
+ * i-th function called by function f
+ */
+int cg_callee(int f, int i);
+
+/* Function cg_reachable returns TRUE if
+ * function f can be called from main
+ */
+int cg_reachable(int f);
+
+/* Function cg_recursive returns TRUE if function
+ * f is on a cycle of the call graph
+ */
+int cg_recursive(int f);
+
+#endif
@@ -1,207 +1,561 @@
 /****************************************************/
 /* File: cgen.c                                     */
 /* The code generator implementation                */
-/* for the TINY compiler                            */
-/* (generates code for the TM machine)              */
+/* for the C-- compiler                             */
+/* (generates code for the TM machine straight      */
+/* from the syntax tree)                            */
 /* Compiler Construction: Principles and Practice   */
 /* Kenneth C. Louden                                */
 /****************************************************/
 
 #include "globals.h"
-#include "symtab.h"
+#include "util.h"
+#include "callgraph.h"
+#include "frame.h"
 #include "code.h"
 #include "cgen.h"
 
-/* tmpOffset is the memory offset for temps
-   It is decremented each time a temp is
-   stored, and incremeted when loaded again
-*/
+/* The frames are those laid out by buildFrames
+ * (see frame.h): the caller stores the arguments
+ * below its own frame, moves mp down by its frame
+ * size F and jumps with the return address in ac1;
+ * the callee saves ac1 at 0(mp) with its first
+ * instruction and returns with LD pc,0(mp), the
+ * result in ac. Expressions are computed into ac;
+ * ac1 holds the other operand of an operation
+ * only for the instruction that reads it.
+ */
+
+/* tmpOffset is the mp offset of the next free
+ * temporary of the current function; it is
+ * decremented each time a temp is stored, and
+ * incremented when loaded again
+ */
 static int tmpOffset = 0;
 
-/* prototype for internal recursive code generator */
-static void cGen(TreeNode *tree);
+/* nextReg is the next free one of the registers
+ * FIRST_TEMP_REG .. LAST_TEMP_REG, which hold the
+ * operand computed first while the other one is
+ * computed (see frame.h)
+ */
+static int nextReg = FIRST_TEMP_REG;
 
-/* Procedure genStmt generates code at a statement node */
-static void genStmt(TreeNode *tree)
+/* frame size of the current function */
+static int frame = 0;
+
+/* the current function and the location after
+ * its prologue, where its self tail calls jump
+ */
+static TreeNode *curFunc = NULL;
+static int bodyLoc = 0;
+
+/* the calls waiting for the location of their
+ * callee
+ */
+typedef struct
 {
-    TreeNode *p1, *p2, *p3;
-    int savedLoc1, savedLoc2, currentLoc;
     int loc;
-    switch (tree->kind.stmt)
+    char *callee;
+    char *op;
+    int reg;
+} CallFixup;
+
+static CallFixup *calls = NULL;
+static int ncalls = 0, maxcalls = 0;
+
+/* the functions generated and their locations */
+static char **funcNames = NULL;
+static int *funcLocs = NULL;
+static int nfuncs = 0, maxfuncs = 0;
+
+static void genError(TreeNode *t, char *message)
+{
+    fprintf(listing, "Code generation error at line %d: %s\n", t->lineno, message);
+    Error = TRUE;
+}
+
+/* Procedure emitCall emits op reg,f once the
+ * location of function f is known
+ */
+static void emitCall(char *op, int reg, char *callee)
+{
+    if (ncalls == maxcalls)
     {
+        maxcalls = maxcalls ? 2 * maxcalls : 16;
+        calls = realloc(calls, maxcalls * sizeof(CallFixup));
+    }
+    calls[ncalls].loc = emitSkip(1);
+    calls[ncalls].callee = callee;
+    calls[ncalls].op = op;
+    calls[ncalls].reg = reg;
+    ncalls++;
+}
 
-    case IfK:
-        if (TraceCode)
-            emitComment("-> if");
-        p1 = tree->child[0];
-        p2 = tree->child[1];
-        p3 = tree->child[2];
-        /* generate code for test expression */
-        cGen(p1);
-        savedLoc1 = emitSkip(1);
-        emitComment("if: jump to else belongs here");
-        /* recurse on then part */
-        cGen(p2);
-        savedLoc2 = emitSkip(1);
-        emitComment("if: jump to end belongs here");
-        currentLoc = emitSkip(0);
-        emitBackup(savedLoc1);
-        emitRM_Abs("JEQ", ac, currentLoc, "if: jmp to else");
-        emitRestore();
-        /* recurse on else part */
-        cGen(p3);
-        currentLoc = emitSkip(0);
-        emitBackup(savedLoc2);
-        emitRM_Abs("LDA", pc, currentLoc, "jmp to end");
-        emitRestore();
-        if (TraceCode)
-            emitComment("<- if");
-        break; /* if_k */
+static int isBuiltin(TreeNode *t, char *name)
+{
+    return t->decl == NULL && strcmp(t->attr.name, name) == 0;
+}
 
-    case RepeatK:
-        if (TraceCode)
-            emitComment("-> repeat");
-        p1 = tree->child[0];
-        p2 = tree->child[1];
-        savedLoc1 = emitSkip(0);
-        emitComment("repeat: jump after body comes back here");
-        /* generate code for body */
-        cGen(p1);
-        /* generate code for test */
-        cGen(p2);
-        emitRM_Abs("JEQ", ac, savedLoc1, "repeat: jmp back to body");
-        if (TraceCode)
-            emitComment("<- repeat");
-        break; /* repeat */
+/* Function isLeaf returns TRUE for the operands
+ * loaded with a single instruction
+ */
+static int isLeaf(TreeNode *t)
+{
+    return t->nodekind == ExpK &&
+           (t->kind.exp == ConstK || (t->kind.exp == IdK && t->decl != NULL));
+}
 
-    case AssignK:
-        if (TraceCode)
-            emitComment("-> assign");
-        /* generate code for rhs */
-        cGen(tree->child[0]);
-        /* now store value */
-        loc = st_lookup(tree->attr.name);
-        emitRM("ST", ac, loc, gp, "assign: store value");
-        if (TraceCode)
-            emitComment("<- assign");
-        break; /* assign_k */
+/* Procedure genLeaf loads the leaf t into reg */
+static void genLeaf(int reg, TreeNode *t)
+{
+    if (t->kind.exp == ConstK)
+        emitRM("LDC", reg, t->attr.val, 0, "load const");
+    else if (t->decl->scope == 0)
+        emitRM("LD", reg, t->decl->memloc, gp, "load global");
+    else
+        emitRM("LD", reg, t->decl->memloc, mp, "load local");
+}
 
-    case ReadK:
-        emitRO("IN", ac, 0, 0, "read integer value");
-        loc = st_lookup(tree->attr.name);
-        emitRM("ST", ac, loc, gp, "read: store value");
-        break;
-    case WriteK:
-        /* generate code for expression to write */
-        cGen(tree->child[0]);
-        /* now output it */
-        emitRO("OUT", ac, 0, 0, "write ac");
-        break;
-    default:
-        break;
+static void genExp(TreeNode *tree);
+
+/* Function saveOperand saves the operand in ac,
+ * the side of the operation, while other is
+ * computed: in a free register unless other
+ * calls a function, else in a temporary. It
+ * returns the register, or -1
+ */
+static int saveOperand(TreeNode *other, char *side)
+{
+    char buf[40];
+    if (nextReg <= LAST_TEMP_REG && !containsCall(other))
+    {
+        sprintf(buf, "op: keep %s", side);
+        emitRM("LDA", nextReg, 0, ac, buf);
+        return nextReg++;
     }
-} /* genStmt */
+    sprintf(buf, "op: push %s", side);
+    emitRM("ST", ac, tmpOffset--, mp, buf);
+    return -1;
+}
+
+/* Procedure loadOperand loads the operand saved
+ * by saveOperand in reg into ac1
+ */
+static void loadOperand(int reg, char *side)
+{
+    char buf[40];
+    sprintf(buf, "op: load %s", side);
+    if (reg >= 0)
+    {
+        emitRM("LDA", ac1, 0, reg, buf);
+        nextReg--;
+    }
+    else
+        emitRM("LD", ac1, ++tmpOffset, mp, buf);
+}
+
+/* Function genOperands computes the operands of
+ * the OpK node t into ac and ac1, the heavier one
+ * first (see heavierRight); a leaf operand goes
+ * straight to ac1 without being saved. It returns
+ * TRUE if the left operand ended in ac1 and the
+ * right one in ac
+ */
+static int genOperands(TreeNode *t)
+{
+    int reg;
+    TreeNode *l = t->child[0], *r = t->child[1];
+    if (isLeaf(r))
+    {
+        genExp(l);
+        genLeaf(ac1, r);
+        return FALSE;
+    }
+    /* a global read late must not move past a call */
+    if (isLeaf(l) && (l->kind.exp == ConstK || l->decl->scope > 0 || !containsCall(r)))
+    {
+        genExp(r);
+        genLeaf(ac1, l);
+        return TRUE;
+    }
+    if (heavierRight(t))
+    {
+        genExp(r);
+        reg = saveOperand(l, "right");
+        genExp(l);
+        loadOperand(reg, "right");
+        return FALSE;
+    }
+    genExp(l);
+    reg = saveOperand(r, "left");
+    genExp(r);
+    loadOperand(reg, "left");
+    return TRUE;
+}
+
+static int isRelop(TokenType op)
+{
+    return op == LT || op == LE || op == RT || op == RE || op == EQ || op == NE;
+}
 
-/* Procedure genExp generates code at an expression node */
+/* Function jumpOp returns the TM jump taken when
+ * the difference of the operands satisfies op
+ */
+static char *jumpOp(TokenType op, int sense)
+{
+    switch (op)
+    {
+    case LT: return sense ? "JLT" : "JGE";
+    case LE: return sense ? "JLE" : "JGT";
+    case RT: return sense ? "JGT" : "JLE";
+    case RE: return sense ? "JGE" : "JLT";
+    case EQ: return sense ? "JEQ" : "JNE";
+    default: return sense ? "JNE" : "JEQ";
+    }
+}
+
+/* Function genCond computes the test t into ac
+ * and returns the jump taken on ac when the test
+ * is sense (TRUE or FALSE); a comparison is
+ * tested directly instead of being turned into
+ * 0 or 1 first
+ */
+static char *genCond(TreeNode *t, int sense)
+{
+    if (t->nodekind == ExpK && t->kind.exp == OpK && isRelop(t->attr.op))
+    {
+        if (genOperands(t))
+            emitRO("SUB", ac, ac1, ac, "compare");
+        else
+            emitRO("SUB", ac, ac, ac1, "compare");
+        return jumpOp(t->attr.op, sense);
+    }
+    genExp(t);
+    return sense ? "JNE" : "JEQ";
+}
+
+/* Procedure genArgs stores the arguments of the
+ * call t below the current frame, where the
+ * callee finds its parameters; when a later
+ * argument contains a call, which reuses that
+ * area, the values wait in temporaries first
+ */
+static int genArgs(TreeNode *t)
+{
+    TreeNode *a;
+    int n = 0, k, staged = FALSE;
+    for (a = t->child[0]; a != NULL; a = a->sibling)
+        if (a != t->child[0] && containsCall(a))
+            staged = TRUE;
+    for (a = t->child[0]; a != NULL; a = a->sibling, n++)
+    {
+        genExp(a);
+        if (staged)
+            emitRM("ST", ac, tmpOffset--, mp, "call: push arg");
+        else
+            emitRM("ST", ac, -frame - 1 - n, mp, "call: store arg");
+    }
+    if (staged)
+    {
+        for (k = n - 1; k >= 0; k--)
+        {
+            emitRM("LD", ac, ++tmpOffset, mp, "call: load arg");
+            emitRM("ST", ac, -frame - 1 - k, mp, "call: store arg");
+        }
+    }
+    return n;
+}
+
+/* Procedure genCall generates a call of a
+ * function of the program
+ */
+static void genCall(TreeNode *t)
+{
+    if (TraceCode)
+        emitComment("-> call");
+    genArgs(t);
+    emitRM("LDA", mp, -frame, mp, "push frame");
+    emitRM("LDA", ac1, 1, pc, "save return address");
+    emitCall("LDA", pc, t->attr.name);
+    emitRM("LDA", mp, frame, mp, "pop frame");
+    if (TraceCode)
+        emitComment("<- call");
+}
+
+/* Function isTailCall returns TRUE if the return
+ * statement t returns the value of a call of a
+ * function of the program
+ */
+static int isTailCall(TreeNode *t)
+{
+    TreeNode *e = t->child[0];
+    return e != NULL && e->nodekind == ExpK && e->kind.exp == CallK &&
+           !isBuiltin(e, "input") && !isBuiltin(e, "output");
+}
+
+/* Procedure genTailCall generates return f(...)
+ * reusing the current frame: the arguments
+ * overwrite the parameters, then a call of the
+ * function itself jumps past its prologue and any
+ * other callee is entered with our return address
+ * in ac1, so it returns straight to our caller
+ */
+static void genTailCall(TreeNode *t)
+{
+    TreeNode *e = t->child[0];
+    int n, k;
+    if (TraceCode)
+        emitComment("-> tail call");
+    if (e->child[0] != NULL && e->child[0]->sibling == NULL)
+    {
+        /* a single argument cannot read a parameter it overwrote */
+        genExp(e->child[0]);
+        emitRM("ST", ac, -1, mp, "tail call: store arg");
+    }
+    else
+    {
+        n = genArgs(e);
+        for (k = 0; k < n; k++)
+        {
+            emitRM("LD", ac, -frame - 1 - k, mp, "tail call: move arg");
+            emitRM("ST", ac, -1 - k, mp, "tail call: over parameter");
+        }
+    }
+    if (strcmp(e->attr.name, curFunc->attr.name) == 0)
+        emitRM_Abs("LDA", pc, bodyLoc, "tail call: jump to body");
+    else
+    {
+        emitRM("LD", ac1, 0, mp, "tail call: pass on return address");
+        emitCall("LDA", pc, e->attr.name);
+    }
+    if (TraceCode)
+        emitComment("<- tail call");
+}
+
+/* Procedure genExp generates code at an expression
+ * node, leaving its value in ac
+ */
 static void genExp(TreeNode *tree)
 {
-    int loc;
-    TreeNode *p1, *p2;
+    int swapped;
     switch (tree->kind.exp)
     {
-
     case ConstK:
-        if (TraceCode)
-            emitComment("-> Const");
-        /* gen code to load integer constant using LDC */
-        emitRM("LDC", ac, tree->attr.val, 0, "load const");
-        if (TraceCode)
-            emitComment("<- Const");
-        break; /* ConstK */
-
     case IdK:
-        if (TraceCode)
-            emitComment("-> Id");
-        loc = st_lookup(tree->attr.name);
-        emitRM("LD", ac, loc, gp, "load id value");
-        if (TraceCode)
-            emitComment("<- Id");
-        break; /* IdK */
+        if (tree->kind.exp == IdK && tree->decl == NULL)
+        {
+            genError(tree, "imported variable cannot be addressed");
+            break;
+        }
+        genLeaf(ac, tree);
+        break;
+
+    case CallK:
+        if (isBuiltin(tree, "input"))
+            emitRO("IN", ac, 0, 0, "read integer value");
+        else if (isBuiltin(tree, "output"))
+        {
+            if (tree->child[0] != NULL)
+                genExp(tree->child[0]);
+            emitRO("OUT", ac, 0, 0, "write ac");
+        }
+        else
+            genCall(tree);
+        break;
 
     case OpK:
         if (TraceCode)
             emitComment("-> Op");
-        p1 = tree->child[0];
-        p2 = tree->child[1];
-        /* gen code for ac = left arg */
-        cGen(p1);
-        /* gen code to push left operand */
-        emitRM("ST", ac, tmpOffset--, mp, "op: push left");
-        /* gen code for ac = right operand */
-        cGen(p2);
-        /* now load left operand */
-        emitRM("LD", ac1, ++tmpOffset, mp, "op: load left");
+        swapped = genOperands(tree);
+        /* l and r are the registers of the left and right operands */
+#define l (swapped ? ac1 : ac)
+#define r (swapped ? ac : ac1)
         switch (tree->attr.op)
         {
         case PLUS:
-            emitRO("ADD", ac, ac1, ac, "op +");
+            emitRO("ADD", ac, l, r, "op +");
             break;
         case MINUS:
-            emitRO("SUB", ac, ac1, ac, "op -");
+            emitRO("SUB", ac, l, r, "op -");
             break;
         case TIMES:
-            emitRO("MUL", ac, ac1, ac, "op *");
+            emitRO("MUL", ac, l, r, "op *");
             break;
         case OVER:
-            emitRO("DIV", ac, ac1, ac, "op /");
+            emitRO("DIV", ac, l, r, "op /");
             break;
         case LT:
-            emitRO("SUB", ac, ac1, ac, "op <");
-            emitRM("JLT", ac, 2, pc, "br if true");
-            emitRM("LDC", ac, 0, ac, "false case");
-            emitRM("LDA", pc, 1, pc, "unconditional jmp");
-            emitRM("LDC", ac, 1, ac, "true case");
-            break;
+        case LE:
+        case RT:
+        case RE:
         case EQ:
-            emitRO("SUB", ac, ac1, ac, "op ==");
-            emitRM("JEQ", ac, 2, pc, "br if true");
-            emitRM("LDC", ac, 0, ac, "false case");
+        case NE:
+            emitRO("SUB", ac, l, r, "compare");
+            emitRM(jumpOp(tree->attr.op, TRUE), ac, 2, pc, "br if true");
+            emitRM("LDC", ac, 0, 0, "false case");
             emitRM("LDA", pc, 1, pc, "unconditional jmp");
-            emitRM("LDC", ac, 1, ac, "true case");
+            emitRM("LDC", ac, 1, 0, "true case");
             break;
         default:
             emitComment("BUG: Unknown operator");
             break;
-        } /* case op */
+        }
+#undef l
+#undef r
         if (TraceCode)
             emitComment("<- Op");
-        break; /* OpK */
+        break;
 
     default:
         break;
     }
 } /* genExp */
 
-/* Procedure cGen recursively generates code by
- * tree traversal
- */
-static void cGen(TreeNode *tree)
+static void genStmts(TreeNode *tree);
+
+/* Procedure genStmt generates code at a statement node */
+static void genStmt(TreeNode *tree)
 {
-    if (tree != NULL)
+    int savedLoc1, savedLoc2, currentLoc;
+    char *jump;
+    switch (tree->kind.stmt)
     {
-        switch (tree->nodekind)
+    case SelectionK:
+        if (TraceCode)
+            emitComment("-> if");
+        jump = genCond(tree->child[0], FALSE);
+        savedLoc1 = emitSkip(1);
+        genStmts(tree->child[1]);
+        if (tree->child[2] != NULL)
+        {
+            savedLoc2 = emitSkip(1);
+            currentLoc = emitSkip(0);
+            emitBackup(savedLoc1);
+            emitRM_Abs(jump, ac, currentLoc, "if: jmp to else");
+            emitRestore();
+            genStmts(tree->child[2]);
+            currentLoc = emitSkip(0);
+            emitBackup(savedLoc2);
+            emitRM_Abs("LDA", pc, currentLoc, "jmp to end");
+            emitRestore();
+        }
+        else
         {
-        case StmtK:
+            currentLoc = emitSkip(0);
+            emitBackup(savedLoc1);
+            emitRM_Abs(jump, ac, currentLoc, "if: jmp to end");
+            emitRestore();
+        }
+        if (TraceCode)
+            emitComment("<- if");
+        break;
+
+    case WhileK:
+        /* the test follows the body, so each pass
+         * through the loop takes a single jump
+         */
+        if (TraceCode)
+            emitComment("-> while");
+        savedLoc1 = emitSkip(1);
+        savedLoc2 = emitSkip(0);
+        genStmts(tree->child[1]);
+        currentLoc = emitSkip(0);
+        emitBackup(savedLoc1);
+        emitRM_Abs("LDA", pc, currentLoc, "while: jmp to test");
+        emitRestore();
+        jump = genCond(tree->child[0], TRUE);
+        emitRM_Abs(jump, ac, savedLoc2, "while: jmp back to body");
+        if (TraceCode)
+            emitComment("<- while");
+        break;
+
+    case AssignK:
+        if (TraceCode)
+            emitComment("-> assign");
+        genExp(tree->child[0]);
+        if (tree->decl == NULL)
+            genError(tree, "imported variable cannot be addressed");
+        else if (tree->decl->scope == 0)
+            emitRM("ST", ac, tree->decl->memloc, gp, "assign: store global");
+        else
+            emitRM("ST", ac, tree->decl->memloc, mp, "assign: store local");
+        if (TraceCode)
+            emitComment("<- assign");
+        break;
+
+    case ReturnK:
+        if (TraceCode)
+            emitComment("-> return");
+        if (isTailCall(tree))
+            genTailCall(tree);
+        else
+        {
+            if (tree->child[0] != NULL)
+                genExp(tree->child[0]);
+            emitRM("LD", pc, RETADDR_OFFSET, mp, "return to caller");
+        }
+        if (TraceCode)
+            emitComment("<- return");
+        break;
+
+    case CompoundK:
+        genStmts(tree->child[1]);
+        break;
+
+    default:
+        break;
+    }
+} /* genStmt */
+
+/* Procedure genStmts generates the statement list
+ * tree, whose expression statements are calls
+ */
+static void genStmts(TreeNode *tree)
+{
+    for (; tree != NULL; tree = tree->sibling)
+        if (tree->nodekind == StmtK)
             genStmt(tree);
-            break;
-        case ExpK:
+        else
             genExp(tree);
-            break;
-        default:
-            break;
-        }
-        cGen(tree->sibling);
+}
+
+/* Procedure genFunc generates function t */
+static void genFunc(TreeNode *t)
+{
+    int f = cg_lookup(t->attr.name);
+    char buf[120];
+    if (f < 0)
+        return;
+    if (nfuncs == maxfuncs)
+    {
+        maxfuncs = maxfuncs ? 2 * maxfuncs : 16;
+        funcNames = realloc(funcNames, maxfuncs * sizeof(char *));
+        funcLocs = realloc(funcLocs, maxfuncs * sizeof(int));
     }
+    sprintf(buf, "-> function %.100s", t->attr.name);
+    emitComment(buf);
+    funcNames[nfuncs] = t->attr.name;
+    funcLocs[nfuncs++] = emitSkip(0);
+    emitSymbol(t->attr.name);
+    curFunc = t;
+    frame = frameSize(f);
+    tmpOffset = frameTempBase(f);
+    nextReg = FIRST_TEMP_REG;
+    emitRM("ST", ac1, RETADDR_OFFSET, mp, "save return address");
+    bodyLoc = emitSkip(0);
+    genStmts(t->child[1]);
+    emitRM("LD", pc, RETADDR_OFFSET, mp, "return to caller");
+    sprintf(buf, "<- function %.100s", t->attr.name);
+    emitComment(buf);
+}
+
+static int funcLoc(char *name)
+{
+    int k;
+    for (k = 0; k < nfuncs; k++)
+        if (strcmp(funcNames[k], name) == 0)
+            return funcLocs[k];
+    return -1;
 }
 
 /**********************************************/
@@ -216,18 +570,53 @@ static void cGen(TreeNode *tree)
 void codeGen(TreeNode *syntaxTree, char *codefile)
 {
     char *s = malloc(strlen(codefile) + 7);
+    TreeNode *t;
+    int k;
     strcpy(s, "File: ");
     strcat(s, codefile);
-    emitComment("TINY Compilation to TM Code");
+    ncalls = 0;
+    nfuncs = 0;
+    emitComment("C-- Compilation to TM Code");
     emitComment(s);
-    /* generate standard prelude */
-    emitComment("Standard prelude:");
-    emitRM("LD", mp, 0, ac, "load maxaddress from location 0");
-    emitRM("ST", ac, 0, ac, "clear location 0");
-    emitComment("End of standard prelude.");
-    /* generate code for TINY program */
-    cGen(syntaxTree);
+    /* generate standard prelude (tmlink adds it to objects) */
+    if (!Relocatable)
+    {
+        emitComment("Standard prelude:");
+        emitRM("LD", mp, 0, ac, "load maxaddress from location 0");
+        emitRM("ST", ac, 0, ac, "clear location 0");
+        emitRM("LDA", ac1, 1, pc, "save return address");
+        emitCall("LDA", pc, "main");
+        emitRO("HALT", 0, 0, 0, "");
+        emitComment("End of standard prelude.");
+    }
+    /* generate code for the functions */
+    for (t = syntaxTree; t != NULL; t = t->sibling)
+        if (t->nodekind == StmtK && t->kind.stmt == FuncDeclarationK)
+            genFunc(t);
+    /* resolve the calls */
+    for (k = 0; k < ncalls; k++)
+    {
+        int loc = funcLoc(calls[k].callee);
+        if (loc < 0 && Relocatable)
+        {
+            emitBackup(calls[k].loc);
+            emitExtern(calls[k].op, calls[k].reg, calls[k].callee, "call");
+            continue;
+        }
+        if (loc < 0)
+        {
+            fprintf(listing, "Code generation error: %s %s\n",
+                    k == 0 ? "no function" : "undefined function", calls[k].callee);
+            Error = TRUE;
+            continue;
+        }
+        emitBackup(calls[k].loc);
+        emitRM_Abs(calls[k].op, calls[k].reg, loc, "call");
+    }
+    emitRestore();
     /* finish */
     emitComment("End of execution.");
-    emitRO("HALT", 0, 0, 0, "");
+    if (!Error) /* a program with errors gets no code */
+        emitFlush();
+    free(s);
 }
@@ -1,6 +1,6 @@
 /****************************************************/
 /* File: cgen.h                                     */
-/* The code generator interface to the TINY compiler*/
+/* The code generator interface to the C-- compiler */
 /* Compiler Construction: Principles and Practice   */
 /* Kenneth C. Louden                                */
 /****************************************************/
@@ -7,23 +7,188 @@
 /****************************************************/
 
 #include "globals.h"
+#include "util.h"
 #include "code.h"
+#include "tmfmt.h"
+
+/* Each thread emits into a buffer of its own, so
+ * functions can be generated concurrently (see
+ * emitDetach and emitAppend); the buffer of the
+ * main thread is the one emitFlush writes
+ */
 
 /* TM location number for current instruction emission */
-static int emitLoc = 0;
+static _Thread_local int emitLoc = 0;
 
 /* Highest TM location emitted so far
    For use in conjunction with emitSkip,
    emitBackup, and emitRestore */
-static int highEmitLoc = 0;
+static _Thread_local int highEmitLoc = 0;
+
+/* one buffered instruction */
+typedef struct
+{
+    TmOp op;
+    int r, s, t; /* t is the offset d of RM instructions */
+    char *comment;
+    int target;  /* pc-relative jumps: absolute target, else -1 */
+    int deleted;
+    char *external; /* calls left to the linker: the callee */
+} TmInstr;
+
+/* a comment line, printed before the instruction at loc */
+typedef struct
+{
+    int loc;
+    int seq; /* order of emission */
+    char *text;
+} TmComment;
+
+/* a named location: kind is TMB_FUNC, TMB_VAR or
+ * TMB_EXTERN (see tmfmt.h)
+ */
+typedef struct
+{
+    int kind;
+    int loc;
+    char *name;
+} TmSymbol;
+
+static _Thread_local TmInstr *buf = NULL;
+static _Thread_local int bufSize = 0;
+static _Thread_local TmComment *comments = NULL;
+static _Thread_local int ncomments = 0, maxcomments = 0;
+static _Thread_local TmSymbol *symbols = NULL;
+static _Thread_local int nsymbols = 0, maxsymbols = 0;
+
+/* code taken out of a thread's buffer */
+struct CodeBuffer
+{
+    TmInstr *buf;
+    int highEmitLoc;
+    TmComment *comments;
+    int ncomments;
+    TmSymbol *symbols;
+    int nsymbols;
+};
+
+/* format of the code file */
+static TmFormat format = TmText;
+
+/* words of globals, for relocatable objects */
+static int nglobals = 0;
+
+/* the instructions the last emitFlush wrote */
+static int flushed = 0;
+
+static char *opNames[] = {
+    "HALT", "IN", "OUT", "ADD", "SUB", "MUL", "DIV",
+    "LD", "ST", "LDA", "LDC",
+    "JLT", "JLE", "JGT", "JGE", "JEQ", "JNE"};
+
+static TmOp opCode(char *op)
+{
+    int i;
+    for (i = 0; i < opNone; i++)
+        if (strcmp(opNames[i], op) == 0)
+            return (TmOp)i;
+    return opNone;
+}
+
+static int isRM(TmOp op)
+{
+    return op >= opLD && op < opNone;
+}
+
+static int isJump(TmOp op)
+{
+    return op >= opJLT && op <= opJNE;
+}
+
+static void grow(int loc)
+{
+    if (loc >= bufSize)
+    {
+        int old = bufSize, i;
+        bufSize = bufSize ? 2 * bufSize : 1024;
+        while (bufSize <= loc)
+            bufSize *= 2;
+        buf = realloc(buf, bufSize * sizeof(TmInstr));
+        for (i = old; i < bufSize; i++)
+            buf[i].op = opNone;
+    }
+}
+
+static void put(TmOp op, int r, int s, int t, char *c)
+{
+    grow(emitLoc);
+    buf[emitLoc].op = op;
+    buf[emitLoc].r = r;
+    buf[emitLoc].s = s;
+    buf[emitLoc].t = t;
+    buf[emitLoc].comment = TraceCode ? copyString(c) : NULL;
+    buf[emitLoc].deleted = FALSE;
+    buf[emitLoc].external = NULL;
+    emitLoc++;
+    if (highEmitLoc < emitLoc)
+        highEmitLoc = emitLoc;
+}
 
 /* Procedure emitComment prints a comment line
  * with comment c in the code file
  */
 void emitComment(char *c)
 {
-    if (TraceCode)
-        fprintf(code, "* %s\n", c);
+    if (!TraceCode)
+        return;
+    if (ncomments == maxcomments)
+    {
+        maxcomments = maxcomments ? 2 * maxcomments : 256;
+        comments = realloc(comments, maxcomments * sizeof(TmComment));
+    }
+    comments[ncomments].loc = emitLoc;
+    comments[ncomments].seq = ncomments;
+    comments[ncomments].text = copyString(c);
+    ncomments++;
+}
+
+/* Function addSymbol enters a symbol and returns
+ * its index; an extern enters only once
+ */
+static int addSymbol(int kind, int loc, char *name)
+{
+    int k;
+    if (kind == TMB_EXTERN)
+        for (k = 0; k < nsymbols; k++)
+            if (symbols[k].kind == TMB_EXTERN && strcmp(symbols[k].name, name) == 0)
+                return k;
+    if (nsymbols == maxsymbols)
+    {
+        maxsymbols = maxsymbols ? 2 * maxsymbols : 64;
+        symbols = realloc(symbols, maxsymbols * sizeof(TmSymbol));
+    }
+    symbols[nsymbols].kind = kind;
+    symbols[nsymbols].loc = loc;
+    symbols[nsymbols].name = copyString(name);
+    return nsymbols++;
+}
+
+/* Procedure emitSymbol names the current code
+ * location, for the symbol table of binary code
+ */
+void emitSymbol(char *name)
+{
+    addSymbol(TMB_FUNC, emitLoc, name);
+}
+
+/* Procedure emitVariable names the global
+ * variable at offset(gp)
+ */
+void emitVariable(char *name, int offset)
+{
+    addSymbol(TMB_VAR, offset, name);
+    if (nglobals <= offset)
+        nglobals = offset + 1;
 }
 
 /* Procedure emitRO emits a register-only
@@ -36,12 +201,7 @@ void emitComment(char *c)
  */
 void emitRO(char *op, int r, int s, int t, char *c)
 {
-    fprintf(code, "%3d:  %5s  %d,%d,%d ", emitLoc++, op, r, s, t);
-    if (TraceCode)
-        fprintf(code, "\t%s", c);
-    fprintf(code, "\n");
-    if (highEmitLoc < emitLoc)
-        highEmitLoc = emitLoc;
+    put(opCode(op), r, s, t, c);
 } /* emitRO */
 
 /* Procedure emitRM emits a register-to-memory
@@ -54,12 +214,7 @@ void emitRO(char *op, int r, int s, int t, char *c)
  */
 void emitRM(char *op, int r, int d, int s, char *c)
 {
-    fprintf(code, "%3d:  %5s  %d,%d(%d) ", emitLoc++, op, r, d, s);
-    if (TraceCode)
-        fprintf(code, "\t%s", c);
-    fprintf(code, "\n");
-    if (highEmitLoc < emitLoc)
-        highEmitLoc = emitLoc;
+    put(opCode(op), r, s, d, c);
 } /* emitRM */
 
 /* Function emitSkip skips "howMany" code
@@ -72,6 +227,7 @@ int emitSkip(int howMany)
     emitLoc += howMany;
     if (highEmitLoc < emitLoc)
         highEmitLoc = emitLoc;
+    grow(emitLoc);
     return i;
 } /* emitSkip */
 
@@ -94,6 +250,78 @@ void emitRestore(void)
     emitLoc = highEmitLoc;
 }
 
+/* Procedure emitExtern emits op r,f for function f
+ * of another module, whose location the linker
+ * fills in (relocatable objects only)
+ */
+void emitExtern(char *op, int r, char *name, char *c)
+{
+    put(opCode(op), r, pc, 0, c);
+    buf[emitLoc - 1].external = name;
+}
+
+/* Function emitDetach takes the code the calling
+ * thread has emitted out of its buffer and returns
+ * it; the thread starts again at location 0
+ */
+CodeBuffer *emitDetach(void)
+{
+    CodeBuffer *b = (CodeBuffer *)malloc(sizeof(CodeBuffer));
+    b->buf = buf;
+    b->highEmitLoc = highEmitLoc;
+    b->comments = comments;
+    b->ncomments = ncomments;
+    b->symbols = symbols;
+    b->nsymbols = nsymbols;
+    buf = NULL;
+    bufSize = 0;
+    comments = NULL;
+    ncomments = maxcomments = 0;
+    symbols = NULL;
+    nsymbols = maxsymbols = 0;
+    emitLoc = highEmitLoc = 0;
+    return b;
+}
+
+/* Function emitAppend moves the detached code b
+ * to the current location, which it returns: the
+ * locations of b's comments and symbols move with
+ * it, and its pc-relative jumps stay valid
+ */
+int emitAppend(CodeBuffer *b)
+{
+    int base = emitLoc, loc, k;
+    grow(base + b->highEmitLoc);
+    for (loc = 0; loc < b->highEmitLoc; loc++)
+        buf[base + loc] = b->buf[loc];
+    for (k = 0; k < b->ncomments; k++)
+    {
+        if (ncomments == maxcomments)
+        {
+            maxcomments = maxcomments ? 2 * maxcomments : 256;
+            comments = realloc(comments, maxcomments * sizeof(TmComment));
+        }
+        comments[ncomments] = b->comments[k];
+        comments[ncomments].loc += base;
+        comments[ncomments].seq = ncomments;
+        ncomments++;
+    }
+    for (k = 0; k < b->nsymbols; k++)
+    {
+        TmSymbol *sym = &b->symbols[k];
+        addSymbol(sym->kind, sym->kind == TMB_FUNC ? sym->loc + base : sym->loc, sym->name);
+        free(sym->name);
+    }
+    emitLoc = base + b->highEmitLoc;
+    if (highEmitLoc < emitLoc)
+        highEmitLoc = emitLoc;
+    free(b->buf);
+    free(b->comments);
+    free(b->symbols);
+    free(b);
+    return base;
+}
+
 /* Procedure emitRM_Abs converts an absolute reference
  * to a pc-relative reference when emitting a
  * register-to-memory TM instruction
@@ -104,12 +332,513 @@ void emitRestore(void)
  */
 void emitRM_Abs(char *op, int r, int a, char *c)
 {
-    fprintf(code, "%3d:  %5s  %d,%d(%d) ",
-            emitLoc, op, r, a - (emitLoc + 1), pc);
-    ++emitLoc;
-    if (TraceCode)
-        fprintf(code, "\t%s", c);
-    fprintf(code, "\n");
-    if (highEmitLoc < emitLoc)
-        highEmitLoc = emitLoc;
+    put(opCode(op), r, pc, a - (emitLoc + 1), c);
 } /* emitRM_Abs */
+
+/**************************************************/
+/***********   peephole optimizer       ***********/
+/**************************************************/
+
+/* isTarget[loc] is TRUE if some jump or return
+ * address points at loc
+ */
+static char *isTarget = NULL;
+
+/* Function live returns the first instruction at
+ * or after loc that has not been deleted
+ */
+static int live(int loc)
+{
+    while (loc < highEmitLoc && buf[loc].deleted)
+        loc++;
+    return loc;
+}
+
+/* Function nextLive returns the instruction
+ * executed after the one at loc falls through
+ */
+static int nextLive(int loc)
+{
+    return live(loc + 1);
+}
+
+static int isUncondJump(TmInstr *i)
+{
+    return i->op == opLDA && i->r == pc && i->target >= 0;
+}
+
+/* Function endsFlow returns TRUE if control never
+ * falls through the instruction
+ */
+static int endsFlow(TmInstr *i)
+{
+    return i->op == opHALT || isUncondJump(i) || i->external != NULL ||
+           (i->op == opLD && i->r == pc);
+}
+
+static int writesReg(TmInstr *i, int r)
+{
+    switch (i->op)
+    {
+    case opIN:
+    case opADD:
+    case opSUB:
+    case opMUL:
+    case opDIV:
+    case opLD:
+    case opLDA:
+    case opLDC:
+        return i->r == r;
+    default:
+        return FALSE;
+    }
+}
+
+static void markTargets(void)
+{
+    int loc;
+    isTarget = realloc(isTarget, highEmitLoc + 1);
+    memset(isTarget, 0, highEmitLoc + 1);
+    for (loc = 0; loc < highEmitLoc; loc++)
+        if (!buf[loc].deleted && buf[loc].target >= 0)
+            isTarget[live(buf[loc].target)] = TRUE;
+    /* other modules enter an object at its functions */
+    for (loc = 0; loc < nsymbols && format == TmObject; loc++)
+        if (symbols[loc].kind == TMB_FUNC)
+            isTarget[live(symbols[loc].loc)] = TRUE;
+}
+
+static void deleteInstr(int loc, int *removed)
+{
+    buf[loc].deleted = TRUE;
+    (*removed)++;
+}
+
+/* Function peephole makes one pass over the buffer
+ * and returns the number of instructions removed
+ */
+static int peephole(void)
+{
+    int loc, removed = 0;
+    markTargets();
+    for (loc = 0; loc < highEmitLoc; loc++)
+    {
+        TmInstr *i = &buf[loc], *j;
+        int next;
+        if (i->deleted || i->op == opNone)
+            continue;
+        /* self-moves */
+        if (i->op == opLDA && i->r == i->s && i->t == 0 && i->r != pc)
+        {
+            deleteInstr(loc, &removed);
+            continue;
+        }
+        if (i->target >= 0)
+        {
+            /* jump chains, jumps to returns */
+            int hops = 0, t = live(i->target);
+            while (t < highEmitLoc && isUncondJump(&buf[t]) && t != loc && hops++ < 16)
+                t = live(buf[t].target);
+            if (t != live(i->target))
+            {
+                i->target = t;
+                isTarget[t] = TRUE;
+            }
+            if (isUncondJump(i) && t < highEmitLoc && buf[t].op == opLD && buf[t].r == pc)
+            {
+                i->op = opLD;
+                i->s = buf[t].s;
+                i->t = buf[t].t;
+                i->target = -1;
+            }
+            /* jumps to the next instruction */
+            else if ((isUncondJump(i) || isJump(i->op)) && t == nextLive(loc))
+            {
+                deleteInstr(loc, &removed);
+                continue;
+            }
+        }
+        /* unreachable code */
+        if (endsFlow(i))
+        {
+            for (next = nextLive(loc); next < highEmitLoc && !isTarget[next] &&
+                                       buf[next].op != opNone;
+                 next = nextLive(next))
+                deleteInstr(next, &removed);
+            continue;
+        }
+        next = nextLive(loc);
+        if (next >= highEmitLoc || isTarget[next])
+            continue;
+        j = &buf[next];
+        /* store then load of the same word */
+        if (i->op == opST && j->op == opLD && j->s == i->s && j->t == i->t &&
+            i->s != pc)
+        {
+            if (j->r == i->r)
+                deleteInstr(next, &removed);
+            else
+            {
+                j->op = opLDA;
+                j->s = i->r;
+                j->t = 0;
+            }
+            continue;
+        }
+        /* load then store back to the same word */
+        if (i->op == opLD && j->op == opST && j->r == i->r && j->s == i->s &&
+            j->t == i->t && i->r != i->s && i->s != pc)
+        {
+            deleteInstr(next, &removed);
+            continue;
+        }
+        /* a constant used once by an add or subtract
+         * becomes the displacement of an LDA
+         */
+        if (i->op == opLDC && (j->op == opADD || j->op == opSUB) &&
+            (i->r == ac1 || i->r == j->r) && j->r != pc)
+        {
+            int c = i->t;
+            if (j->t == i->r && j->s != i->r)
+            {
+                j->t = j->op == opADD ? c : -c;
+                j->op = opLDA;
+                deleteInstr(loc, &removed);
+            }
+            else if (j->op == opADD && j->s == i->r && j->t != i->r)
+            {
+                j->s = j->t;
+                j->t = c;
+                j->op = opLDA;
+                deleteInstr(loc, &removed);
+            }
+            continue;
+        }
+        /* a value overwritten before it is read */
+        if ((i->op == opLDC || i->op == opLDA) && i->r != pc && writesReg(j, i->r) &&
+            !(j->op != opLDC && (j->s == i->r || (!isRM(j->op) && j->t == i->r))))
+            deleteInstr(loc, &removed);
+    }
+    return removed;
+}
+
+/**************************************************/
+/***********   writing the code file    ***********/
+/**************************************************/
+
+/* Procedure emitFormat selects the format in
+ * which emitFlush writes the code file
+ */
+void emitFormat(TmFormat f)
+{
+    format = f;
+}
+
+/* The whole code file is built in out and
+ * written with a single fwrite
+ */
+static struct
+{
+    char *text;
+    int len, size;
+} out = {NULL, 0, 0};
+
+static void reserve(int n)
+{
+    if (out.len + n > out.size)
+    {
+        out.size = out.size ? 2 * out.size : 65536;
+        while (out.len + n > out.size)
+            out.size *= 2;
+        out.text = realloc(out.text, out.size);
+    }
+}
+
+static void putStr(char *str, int width)
+{
+    int n = strlen(str);
+    reserve(n + (width > n ? width - n : 0));
+    for (; width > n; width--)
+        out.text[out.len++] = ' ';
+    memcpy(out.text + out.len, str, n);
+    out.len += n;
+}
+
+/* Procedure putNum appends n right-justified in
+ * width columns, as printf("%*d") would
+ */
+static void putNum(int n, int width)
+{
+    char digits[12], *d = digits + sizeof(digits);
+    unsigned u = n < 0 ? -(unsigned)n : (unsigned)n;
+    *--d = '\0';
+    do
+        *--d = '0' + u % 10;
+    while ((u /= 10) != 0);
+    if (n < 0)
+        *--d = '-';
+    putStr(d, width);
+}
+
+static void putBytes(void *bytes, int n)
+{
+    reserve(n);
+    memcpy(out.text + out.len, bytes, n);
+    out.len += n;
+}
+
+static void putComment(char *text)
+{
+    putStr("* ", 0);
+    putStr(text, 0);
+    putStr("\n", 0);
+}
+
+/* Procedure putText appends the text form of
+ * instruction i at location loc, the line that
+ * tm reads
+ */
+static void putText(int loc, TmInstr *i)
+{
+    putNum(loc, 3);
+    putStr(":  ", 0);
+    putStr(opNames[i->op], 5);
+    putStr("  ", 0);
+    putNum(i->r, 0);
+    putStr(",", 0);
+    if (isRM(i->op))
+    {
+        putNum(i->t, 0);
+        putStr("(", 0);
+        putNum(i->s, 0);
+        putStr(") ", 0);
+    }
+    else
+    {
+        putNum(i->s, 0);
+        putStr(",", 0);
+        putNum(i->t, 0);
+        putStr(" ", 0);
+    }
+    if (TraceCode)
+    {
+        putStr("\t", 0);
+        putStr(i->comment, 0);
+    }
+    putStr("\n", 0);
+}
+
+/* Procedure putBinary appends instruction i as
+ * a TmbInstr: its opcode numbered as in tm.c,
+ * which leaves a gap after the register-only and
+ * the memory opcodes, then r, and s,t or d,s; a
+ * location never filled holds HALT, as tm assumes
+ * in text
+ */
+static void putBinary(TmInstr *i)
+{
+    TmbInstr rec = {0, 0, 0, 0};
+    if (i->op != opNone)
+    {
+        rec.iop = i->op + (i->op >= opLD) + (i->op >= opLDA);
+        rec.iarg1 = i->r;
+        rec.iarg2 = isRM(i->op) ? i->t : i->s;
+        rec.iarg3 = isRM(i->op) ? i->s : i->t;
+    }
+    putBytes(&rec, sizeof(rec));
+}
+
+/* Procedure putHeader appends the header of a
+ * binary code file of n instructions and nrelocs
+ * relocations
+ */
+static void putHeader(int n, int nrelocs)
+{
+    TmbHeader h;
+    int k;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, TMB_MAGIC, sizeof(h.magic));
+    h.version = TMB_VERSION;
+    h.kind = format == TmObject ? TMB_OBJECT : TMB_PROGRAM;
+    h.ninstr = n;
+    h.dataBase = 0;
+    h.ndata = 0;
+    h.nglobals = nglobals;
+    h.nsyms = nsymbols;
+    h.nrelocs = nrelocs;
+    for (k = 0; k < nsymbols; k++)
+        h.strsize += strlen(symbols[k].name) + 1;
+    putBytes(&h, sizeof(h));
+}
+
+/* Procedure putSymbols appends the symbol table,
+ * newLoc giving the final location of each
+ * buffered one
+ */
+static void putSymbols(int *newLoc)
+{
+    int k, offset = 0;
+    for (k = 0; k < nsymbols; k++)
+    {
+        TmbSymbol sym;
+        sym.kind = symbols[k].kind;
+        sym.loc = sym.kind == TMB_FUNC ? newLoc[symbols[k].loc] : symbols[k].loc;
+        sym.name = offset;
+        offset += strlen(symbols[k].name) + 1;
+        putBytes(&sym, sizeof(sym));
+    }
+}
+
+/* Procedure putStrings appends the names of the
+ * symbols, in the order of putSymbols
+ */
+static void putStrings(void)
+{
+    int k;
+    for (k = 0; k < nsymbols; k++)
+        putBytes(symbols[k].name, strlen(symbols[k].name) + 1);
+}
+
+/* Function relocKind returns the relocation the
+ * instruction i of an object needs, or -1
+ */
+static int relocKind(TmInstr *i)
+{
+    if (i->deleted || i->op == opNone)
+        return -1;
+    if (i->external != NULL)
+        return TMB_RCALL;
+    if (isRM(i->op) && i->op != opLDC && i->s == gp)
+        return TMB_RGLOBAL;
+    return -1;
+}
+
+/* Procedure putRelocs appends the relocations of
+ * an object
+ */
+static void putRelocs(int *newLoc)
+{
+    int loc;
+    for (loc = 0; loc < highEmitLoc; loc++)
+    {
+        TmbReloc rel;
+        rel.kind = relocKind(&buf[loc]);
+        if (rel.kind < 0)
+            continue;
+        rel.loc = newLoc[loc];
+        rel.sym = rel.kind == TMB_RCALL ? addSymbol(TMB_EXTERN, -1, buf[loc].external) : -1;
+        putBytes(&rel, sizeof(rel));
+    }
+}
+
+static int byLoc(const void *x, const void *y)
+{
+    const TmComment *a = (const TmComment *)x, *b = (const TmComment *)y;
+    if (a->loc != b->loc)
+        return a->loc - b->loc;
+    return a->seq - b->seq;
+}
+
+/* Procedure emitFlush runs the peephole optimizer
+ * over the buffered instructions, writes them to
+ * the code file in location order, in the format
+ * chosen by emitFormat, and empties the buffer
+ */
+void emitFlush(void)
+{
+    int loc, c = 0, n, removed = 0, total = 0;
+    int *newLoc;
+    grow(highEmitLoc);
+    for (loc = 0; loc < highEmitLoc; loc++)
+    {
+        TmInstr *i = &buf[loc];
+        i->target = -1;
+        if (i->op == opNone)
+        {
+            i->deleted = FALSE;
+            continue;
+        }
+        total++;
+        if (isRM(i->op) && i->op != opLDC && i->s == pc && i->external == NULL)
+            i->target = loc + 1 + i->t;
+    }
+    do
+    {
+        n = peephole();
+        removed += n;
+    } while (n > 0);
+    qsort(comments, ncomments, sizeof(TmComment), byLoc);
+    /* compact the code and fix the pc-relative offsets */
+    newLoc = (int *)malloc((highEmitLoc + 1) * sizeof(int));
+    for (loc = 0, n = 0; loc <= highEmitLoc; loc++)
+    {
+        newLoc[loc] = n;
+        if (loc < highEmitLoc && !buf[loc].deleted)
+            n++;
+    }
+    out.len = 0;
+    if (format != TmText)
+    {
+        /* the externs join the symbols before the header counts them */
+        for (loc = 0, n = 0; loc < highEmitLoc; loc++)
+            if (format == TmObject && relocKind(&buf[loc]) >= 0)
+            {
+                if (buf[loc].external != NULL)
+                    addSymbol(TMB_EXTERN, -1, buf[loc].external);
+                n++;
+            }
+        putHeader(newLoc[highEmitLoc], n);
+    }
+    flushed = newLoc[highEmitLoc];
+    for (loc = 0; loc < highEmitLoc; loc++)
+    {
+        TmInstr *i = &buf[loc];
+        if (i->deleted)
+            continue;
+        if (i->target >= 0)
+            i->t = newLoc[i->target] - (newLoc[loc] + 1);
+        if (format != TmText)
+        {
+            putBinary(i);
+            continue;
+        }
+        while (c < ncomments && comments[c].loc <= loc)
+            putComment(comments[c++].text);
+        if (i->op != opNone)
+            putText(newLoc[loc], i);
+    }
+    if (format == TmText)
+        while (c < ncomments)
+            putComment(comments[c++].text);
+    else
+        putSymbols(newLoc);
+    if (format == TmObject)
+        putRelocs(newLoc);
+    if (format != TmText)
+        putStrings();
+    fwrite(out.text, 1, out.len, code);
+    if (TraceOpt)
+        fprintf(listing, "\nPeephole: %d of %d instructions removed\n", removed, total);
+    free(newLoc);
+    for (loc = 0; loc < highEmitLoc; loc++)
+    {
+        free(buf[loc].comment);
+        buf[loc].op = opNone;
+    }
+    for (c = 0; c < ncomments; c++)
+        free(comments[c].text);
+    ncomments = 0;
+    for (c = 0; c < nsymbols; c++)
+        free(symbols[c].name);
+    nsymbols = 0;
+    nglobals = 0;
+    emitLoc = highEmitLoc = 0;
+}
+
+/* Function emitCount returns the number of
+ * instructions the last emitFlush wrote
+ */
+int emitCount(void)
+{
+    return flushed;
+}
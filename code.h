@@ -29,6 +29,40 @@
 /* 2nd accumulator */
 #define  ac1 1
 
+/* TM opcodes, in the order of tm.c */
+typedef enum
+{
+    opHALT,
+    opIN,
+    opOUT,
+    opADD,
+    opSUB,
+    opMUL,
+    opDIV,
+    opLD,
+    opST,
+    opLDA,
+    opLDC,
+    opJLT,
+    opJLE,
+    opJGT,
+    opJGE,
+    opJEQ,
+    opJNE,
+    opNone /* a skipped location never filled */
+} TmOp;
+
+/* Instructions are collected in a buffer (one per
+ * thread) and only written to the code file by
+ * emitFlush, after the peephole optimizer has run
+ * over them. The optimizer relies on two
+ * conventions of the code generators: ac1 never carries a value past the
+ * instruction that reads it (the return address is
+ * stored by the first instruction of the callee),
+ * and control only enters code through pc-relative
+ * jumps and return addresses.
+ */
+
 /* code emitting utilities */
 
 /* Procedure emitComment prints a comment line 
@@ -36,6 +70,22 @@
  */
 void emitComment( char * c );
 
+/* Procedure emitSymbol names the current code
+ * location, for the symbol table of binary code
+ */
+void emitSymbol( char * name );
+
+/* Procedure emitVariable names the global
+ * variable at offset(gp)
+ */
+void emitVariable( char * name, int offset );
+
+/* Procedure emitExtern emits op r,f for function f
+ * of another module, whose location the linker
+ * fills in (relocatable objects only)
+ */
+void emitExtern( char * op, int r, char * name, char * c );
+
 /* Procedure emitRO emits a register-only
  * TM instruction
  * op = the opcode
@@ -73,6 +123,24 @@ void emitBackup( int loc);
  */
 void emitRestore(void);
 
+/* Code emitted by one thread, taken out of its
+ * buffer by emitDetach
+ */
+typedef struct CodeBuffer CodeBuffer;
+
+/* Function emitDetach takes the code the calling
+ * thread has emitted out of its buffer and returns
+ * it; the thread starts again at location 0
+ */
+CodeBuffer * emitDetach(void);
+
+/* Function emitAppend moves the detached code b
+ * to the current location, which it returns: the
+ * locations of b's comments and symbols move with
+ * it, and its pc-relative jumps stay valid
+ */
+int emitAppend( CodeBuffer * b );
+
 /* Procedure emitRM_Abs converts an absolute reference 
  * to a pc-relative reference when emitting a
  * register-to-memory TM instruction
@@ -83,4 +151,30 @@ void emitRestore(void);
  */
 void emitRM_Abs( char *op, int r, int a, char * c);
 
+/* formats of the code file */
+typedef enum
+{
+    TmText,   /* the listing read by tm, with comments */
+    TmBinary, /* a .tmb program (see tmfmt.h) */
+    TmObject  /* a .tmo relocatable object for tmlink */
+} TmFormat;
+
+/* Procedure emitFormat selects the format in
+ * which emitFlush writes the code file
+ * (TmText unless changed)
+ */
+void emitFormat(TmFormat f);
+
+/* Procedure emitFlush runs the peephole optimizer
+ * over the buffered instructions, writes them to
+ * the code file in location order, in the format
+ * chosen by emitFormat, and empties the buffer
+ */
+void emitFlush(void);
+
+/* Function emitCount returns the number of
+ * instructions the last emitFlush wrote
+ */
+int emitCount(void);
+
 #endif
@@ -0,0 +1,299 @@
+/****************************************************/
+/* File: fold.c                                     */
+/* Constant folding and propagation                 */
+/* for the C-- compiler                             */
+/****************************************************/
+
+#include <limits.h>
+#include "globals.h"
+#include "fold.h"
+
+/* MAXCONSTS = the number of local variables
+ * whose constant value can be tracked at once
+ */
+#define MAXCONSTS 64
+
+/* the local variables known to hold a constant
+ * at the current point of straight-line code
+ */
+typedef struct
+{
+    TreeNode *decl[MAXCONSTS];
+    int val[MAXCONSTS];
+    int n;
+} ConstEnv;
+
+/* number of nodes folded so far */
+static int folded = 0;
+
+static int isLocal(TreeNode *decl)
+{
+    return decl != NULL && decl->scope > 0;
+}
+
+static int envLookup(ConstEnv *env, TreeNode *decl, int *val)
+{
+    int i;
+    for (i = 0; i < env->n; i++)
+        if (env->decl[i] == decl)
+        {
+            *val = env->val[i];
+            return TRUE;
+        }
+    return FALSE;
+}
+
+static void envKill(ConstEnv *env, TreeNode *decl)
+{
+    int i;
+    for (i = 0; i < env->n; i++)
+        if (env->decl[i] == decl)
+        {
+            env->n--;
+            env->decl[i] = env->decl[env->n];
+            env->val[i] = env->val[env->n];
+            return;
+        }
+}
+
+static void envSet(ConstEnv *env, TreeNode *decl, int val)
+{
+    envKill(env, decl);
+    if (env->n < MAXCONSTS)
+    {
+        env->decl[env->n] = decl;
+        env->val[env->n] = val;
+        env->n++;
+    }
+}
+
+/* Procedure envMeet keeps in env only the facts
+ * that also hold in other, for the join point
+ * after an if statement
+ */
+static void envMeet(ConstEnv *env, ConstEnv *other)
+{
+    int i = 0;
+    while (i < env->n)
+    {
+        int val;
+        if (envLookup(other, env->decl[i], &val) && val == env->val[i])
+            i++;
+        else
+            envKill(env, env->decl[i]);
+    }
+}
+
+/* Procedure killAssigned forgets every local
+ * variable assigned anywhere in the tree t
+ */
+static void killAssigned(ConstEnv *env, TreeNode *t)
+{
+    while (t != NULL)
+    {
+        int i;
+        if (t->nodekind == StmtK && t->kind.stmt == AssignK)
+            envKill(env, t->decl);
+        for (i = 0; i < MAXCHILDREN; i++)
+            killAssigned(env, t->child[i]);
+        t = t->sibling;
+    }
+}
+
+/* Function foldOp evaluates a op b into *result;
+ * it returns FALSE when the operation must be
+ * left to run time (division by zero, overflow)
+ */
+int foldOp(TokenType op, int a, int b, int *result)
+{
+    switch (op)
+    {
+    case PLUS:
+        *result = (int)((unsigned)a + (unsigned)b);
+        break;
+    case MINUS:
+        *result = (int)((unsigned)a - (unsigned)b);
+        break;
+    case TIMES:
+        *result = (int)((unsigned)a * (unsigned)b);
+        break;
+    case OVER:
+        if (b == 0 || (a == INT_MIN && b == -1))
+            return FALSE;
+        *result = a / b;
+        break;
+    case LT:
+        *result = a < b;
+        break;
+    case LE:
+        *result = a <= b;
+        break;
+    case RT:
+        *result = a > b;
+        break;
+    case RE:
+        *result = a >= b;
+        break;
+    case EQ:
+        *result = a == b;
+        break;
+    case NE:
+        *result = a != b;
+        break;
+    default:
+        return FALSE;
+    }
+    return TRUE;
+}
+
+/* Procedure makeConst turns the expression
+ * node t into a constant node in place
+ */
+static void makeConst(TreeNode *t, int val)
+{
+    int i;
+    for (i = 0; i < MAXCHILDREN; i++)
+        t->child[i] = NULL;
+    t->kind.exp = ConstK;
+    t->attr.val = val;
+    t->decl = NULL;
+    folded++;
+}
+
+/* Procedure makeBlock turns the statement node t
+ * into a compound statement holding only body
+ */
+static void makeBlock(TreeNode *t, TreeNode *body)
+{
+    t->kind.stmt = CompoundK;
+    t->child[0] = NULL;
+    t->child[1] = body;
+    t->child[2] = NULL;
+    folded++;
+}
+
+static void foldExp(TreeNode *t, ConstEnv *env);
+
+/* Procedure foldArgs folds the argument list t */
+static void foldArgs(TreeNode *t, ConstEnv *env)
+{
+    for (; t != NULL; t = t->sibling)
+        foldExp(t, env);
+}
+
+/* Procedure foldExp folds the expression t */
+static void foldExp(TreeNode *t, ConstEnv *env)
+{
+    int val;
+    if (t == NULL || t->nodekind != ExpK)
+        return;
+    switch (t->kind.exp)
+    {
+    case OpK:
+        foldExp(t->child[0], env);
+        foldExp(t->child[1], env);
+        if (t->child[0] != NULL && t->child[0]->kind.exp == ConstK &&
+            t->child[1] != NULL && t->child[1]->kind.exp == ConstK &&
+            foldOp(t->attr.op, t->child[0]->attr.val,
+                   t->child[1]->attr.val, &val))
+            makeConst(t, val);
+        break;
+    case IdK:
+        if (isLocal(t->decl) && envLookup(env, t->decl, &val))
+            makeConst(t, val);
+        break;
+    case CallK:
+        foldArgs(t->child[0], env);
+        break;
+    default:
+        break;
+    }
+}
+
+static int isConst(TreeNode *t)
+{
+    return t != NULL && t->nodekind == ExpK && t->kind.exp == ConstK;
+}
+
+/* Procedure foldStmt folds the statement list t
+ * in order, tracking constant locals in env
+ */
+static void foldStmt(TreeNode *t, ConstEnv *env)
+{
+    for (; t != NULL; t = t->sibling)
+    {
+        ConstEnv other;
+        if (t->nodekind == ExpK)
+        {
+            foldExp(t, env);
+            continue;
+        }
+        switch (t->kind.stmt)
+        {
+        case AssignK:
+            foldExp(t->child[0], env);
+            if (isLocal(t->decl))
+            {
+                if (isConst(t->child[0]))
+                    envSet(env, t->decl, t->child[0]->attr.val);
+                else
+                    envKill(env, t->decl);
+            }
+            break;
+        case ReturnK:
+            foldExp(t->child[0], env);
+            break;
+        case VarDeclarationK:
+            envKill(env, t);
+            break;
+        case CompoundK:
+            foldStmt(t->child[1], env);
+            break;
+        case SelectionK:
+            foldExp(t->child[0], env);
+            if (isConst(t->child[0]))
+            {
+                makeBlock(t, t->child[0]->attr.val ? t->child[1] : t->child[2]);
+                foldStmt(t->child[1], env);
+                break;
+            }
+            other = *env;
+            foldStmt(t->child[1], env);
+            foldStmt(t->child[2], &other);
+            envMeet(env, &other);
+            break;
+        case WhileK:
+            killAssigned(env, t->child[1]);
+            foldExp(t->child[0], env);
+            if (isConst(t->child[0]) && t->child[0]->attr.val == 0)
+            {
+                makeBlock(t, NULL);
+                break;
+            }
+            other = *env;
+            foldStmt(t->child[1], &other);
+            break;
+        case FuncDeclarationK:
+            other.n = 0;
+            foldStmt(t->child[1], &other);
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+/* Function foldConstants evaluates constant
+ * subtrees of the type-checked syntax tree in
+ * place and returns the number of nodes folded
+ */
+int foldConstants(TreeNode *syntaxTree)
+{
+    ConstEnv env;
+    env.n = 0;
+    folded = 0;
+    foldStmt(syntaxTree, &env);
+    if (TraceOpt)
+        fprintf(listing, "Constant folding: %d nodes folded\n", folded);
+    return folded;
+}
@@ -0,0 +1,26 @@
+/****************************************************/
+/* File: fold.h                                     */
+/* Constant folding and propagation interface       */
+/* for the C-- compiler                             */
+/****************************************************/
+
+#ifndef _FOLD_H_
+#define _FOLD_H_
+
+/* Function foldOp evaluates a op b into *result;
+ * it returns FALSE when the operation must be
+ * left to run time (division by zero, overflow)
+ */
+int foldOp(TokenType op, int a, int b, int *result);
+
+/* Function foldConstants evaluates constant
+ * subtrees of the type-checked syntax tree in
+ * place, propagates constants assigned to local
+ * variables through straight-line code and
+ * removes if/while statements whose test folds
+ * to a constant; it returns the number of nodes
+ * folded
+ */
+int foldConstants(TreeNode *syntaxTree);
+
+#endif
@@ -0,0 +1,260 @@
+/****************************************************/
+/* File: frame.c                                    */
+/* Storage layout, frame-size and stack-depth       */
+/* analysis for the C-- compiler                    */
+/****************************************************/
+
+#include "globals.h"
+#include "util.h"
+#include "callgraph.h"
+#include "frame.h"
+
+/* the layout of one function's frame */
+typedef struct
+{
+    int params;
+    int locals;
+    int temps;
+    int size;
+    int stack;    /* deepest stack from a call of it, -1 = unbounded */
+    int visiting; /* for the stack-depth search */
+    int laidOut;  /* size comes from the back end */
+} FrameRec;
+
+static FrameRec *frames = NULL;
+static int nframes = 0;
+static int nglobals = 0;
+static int bound = 0;
+static int stale = FALSE; /* a frame changed since bound was computed */
+
+static void computeBound(void);
+
+int frameSize(int f)
+{
+    return frames[f].size;
+}
+
+int frameTempBase(int f)
+{
+    return -(1 + frames[f].params + frames[f].locals);
+}
+
+int globalSize(void)
+{
+    return nglobals;
+}
+
+int stackBound(void)
+{
+    if (stale)
+        computeBound();
+    return bound;
+}
+
+void setFrameSize(int f, int size)
+{
+    frames[f].size = size;
+    frames[f].laidOut = TRUE;
+    stale = TRUE;
+}
+
+static int max(int a, int b)
+{
+    return a > b ? a : b;
+}
+
+/* Function expTemps returns the number of
+ * temporaries genExp needs for the expression t
+ * while regs registers are free
+ */
+static int expTemps(TreeNode *t, int regs)
+{
+    TreeNode *a, *first, *second;
+    int need = 0, i = 0, staged = FALSE;
+    if (t == NULL || t->nodekind != ExpK)
+        return 0;
+    switch (t->kind.exp)
+    {
+    case OpK:
+        /* the operand evaluated first is saved while
+         * the other one is computed, in a register if
+         * one is free and the other one calls nothing
+         */
+        first = t->child[heavierRight(t)];
+        second = t->child[!heavierRight(t)];
+        if (regs > 0 && !containsCall(second))
+            return max(expTemps(first, regs), expTemps(second, regs - 1));
+        return max(expTemps(first, regs), 1 + expTemps(second, regs));
+    case CallK:
+        for (a = t->child[0]; a != NULL; a = a->sibling)
+            if (a != t->child[0] && containsCall(a))
+                staged = TRUE;
+        for (a = t->child[0]; a != NULL; a = a->sibling, i++)
+            need = max(need, (staged ? i : 0) + expTemps(a, regs));
+        return staged ? max(need, i) : need;
+    default:
+        return 0;
+    }
+}
+
+/* Function stmtTemps returns the number of
+ * temporaries the statement list t needs
+ */
+static int stmtTemps(TreeNode *t)
+{
+    int need = 0;
+    for (; t != NULL; t = t->sibling)
+    {
+        int i;
+        if (t->nodekind == ExpK)
+        {
+            need = max(need, expTemps(t, LAST_TEMP_REG - FIRST_TEMP_REG + 1));
+            continue;
+        }
+        for (i = 0; i < MAXCHILDREN; i++)
+            need = max(need, stmtTemps(t->child[i]));
+    }
+    return need;
+}
+
+/* Function layoutLocals gives the locals declared
+ * in the statement list t the frame words after
+ * the first used words; it returns the number of
+ * words in use at the deepest point
+ */
+static int layoutLocals(TreeNode *t, int used)
+{
+    int deepest = used;
+    for (; t != NULL; t = t->sibling)
+    {
+        int i;
+        if (t->nodekind != StmtK)
+            continue;
+        if (t->kind.stmt == CompoundK)
+        {
+            int inner = used;
+            TreeNode *d;
+            for (d = t->child[0]; d != NULL; d = d->sibling)
+                d->memloc = -(++inner);
+            deepest = max(deepest, layoutLocals(t->child[1], inner));
+            continue;
+        }
+        for (i = 0; i < MAXCHILDREN; i++)
+            deepest = max(deepest, layoutLocals(t->child[i], used));
+    }
+    return deepest;
+}
+
+/* Function stackFrom returns the deepest stack a
+ * call of function f can reach, or -1
+ */
+static int stackFrom(int f)
+{
+    FrameRec *r = &frames[f];
+    int i, deepest = 0;
+    if (r->stack != 0 || r->visiting)
+        return r->stack;
+    if (cg_recursive(f))
+        return r->stack = -1;
+    r->visiting = TRUE;
+    for (i = 0; i < cg_ncallees(f); i++)
+    {
+        int s = stackFrom(cg_callee(f, i));
+        if (s < 0)
+        {
+            deepest = -1;
+            break;
+        }
+        deepest = max(deepest, s);
+    }
+    r->visiting = FALSE;
+    return r->stack = deepest < 0 ? -1 : r->size + deepest;
+}
+
+/* Procedure computeBound bounds the stack depth
+ * from main with the current frame sizes
+ */
+static void computeBound(void)
+{
+    int f, main = cg_lookup("main");
+    for (f = 0; f < nframes; f++)
+    {
+        frames[f].stack = 0;
+        frames[f].visiting = FALSE;
+    }
+    bound = main >= 0 ? stackFrom(main) : -1;
+    stale = FALSE;
+}
+
+/* Procedure buildFrames assigns the storage of
+ * every declaration, computes frame sizes and
+ * bounds the stack depth from main
+ */
+void buildFrames(TreeNode *syntaxTree)
+{
+    TreeNode *t;
+    int n = cg_count();
+    int f, k;
+    frames = realloc(frames, (n + 1) * sizeof(FrameRec));
+    nframes = n;
+    nglobals = 0;
+    for (t = syntaxTree; t != NULL; t = t->sibling)
+        if (t->nodekind == StmtK && t->kind.stmt == VarDeclarationK)
+            t->memloc = nglobals++;
+    for (f = 0; f < n; f++)
+    {
+        FrameRec *r = &frames[f];
+        TreeNode *fn = cg_decl(f);
+        TreeNode *p;
+        r->params = paramCount(fn->child[0]);
+        if (r->params > 0)
+            for (p = fn->child[0], k = 0; p != NULL; p = p->sibling)
+                p->memloc = -(++k);
+        r->locals = layoutLocals(fn->child[1], r->params) - r->params;
+        r->temps = stmtTemps(fn->child[1]);
+        r->size = 1 + r->params + r->locals + r->temps;
+        r->laidOut = FALSE;
+    }
+    computeBound();
+}
+
+/* Procedure printFrames writes the frame table
+ * and the data memory bound to the listing
+ */
+void printFrames(void)
+{
+    int f, main = cg_lookup("main");
+    if (stale)
+        computeBound();
+    fprintf(listing, "\nFrame layout:\n\n");
+    fprintf(listing, "Function       Params  Locals  Temps  Frame  Stack\n");
+    fprintf(listing, "-------------  ------  ------  -----  -----  -----\n");
+    for (f = 0; f < nframes; f++)
+    {
+        FrameRec *r = &frames[f];
+        if (!cg_reachable(f))
+            continue;
+        fprintf(listing, "%-14s %6d  ", cg_decl(f)->attr.name, r->params);
+        if (!r->laidOut)
+            fprintf(listing, "%6d  %5d  %5d  ", r->locals, r->temps, r->size);
+        else if (r->size > 0)
+            fprintf(listing, "%6s  %5s  %5d  ", "-", "-", r->size);
+        else
+        {
+            fprintf(listing, "inlined everywhere\n");
+            continue;
+        }
+        if (stackFrom(f) < 0)
+            fprintf(listing, "unbounded\n");
+        else
+            fprintf(listing, "%5d\n", stackFrom(f));
+    }
+    if (main < 0)
+        fprintf(listing, "Data memory needed: %d globals (no main)\n", nglobals);
+    else if (bound >= 0)
+        fprintf(listing, "Data memory needed: %d globals + %d stack = %d words\n",
+                nglobals, bound, nglobals + bound);
+    else
+        fprintf(listing, "Data memory needed: %d globals + unbounded stack "
+                "(recursion)\n", nglobals);
+}
@@ -0,0 +1,84 @@
+/****************************************************/
+/* File: frame.h                                    */
+/* Storage layout, frame-size and stack-depth       */
+/* analysis for the C-- compiler                    */
+/****************************************************/
+
+#ifndef _FRAME_H_
+#define _FRAME_H_
+
+/* Globals are addressed from gp, starting at 0.
+ * Each call has a fixed-size frame addressed
+ * from mp, growing down from the caller's frame:
+ *
+ *    0(mp)              return address
+ *   -1(mp) .. -p(mp)    the p parameters
+ *   next                local variables (blocks
+ *                       that cannot be live at
+ *                       the same time share slots)
+ *   next                expression temporaries
+ *
+ * A caller with frame size F stores argument i at
+ * -F-1-i(mp) and moves mp down by F for the call.
+ *
+ * Temporaries follow the order of genExp: the
+ * operand of an OpK evaluated first (the heavier
+ * one by Sethi-Ullman number, see heavierRight)
+ * is saved while the other one is computed, in
+ * the first free register of FIRST_TEMP_REG ..
+ * LAST_TEMP_REG if the other one calls no
+ * function (the callee uses them too) and in a
+ * temporary otherwise, and the arguments of a call
+ * are staged in temporaries only when a later
+ * argument contains a call (which would reuse the
+ * callee frame).
+ */
+#define RETADDR_OFFSET 0
+
+#define FIRST_TEMP_REG 2
+#define LAST_TEMP_REG 4
+
+/* Procedure buildFrames assigns the gp offset of
+ * every global and the mp offset of every
+ * parameter and local (in the memloc field of the
+ * declarations), computes the frame size of every
+ * function in the call graph and bounds the stack
+ * depth from main
+ */
+void buildFrames(TreeNode *syntaxTree);
+
+/* Function frameSize returns the size in words of
+ * the frame of call graph function f
+ */
+int frameSize(int f);
+
+/* Function frameTempBase returns the mp offset of
+ * the first temporary of call graph function f
+ */
+int frameTempBase(int f);
+
+/* Function globalSize returns the number of
+ * words of global variables
+ */
+int globalSize(void);
+
+/* Function stackBound returns the most stack any
+ * run of the program can use, in words, or -1 if
+ * a recursive call chain makes it unbounded
+ */
+int stackBound(void);
+
+/* Procedure setFrameSize records the size of the
+ * frame the back end laid out for call graph
+ * function f, 0 if it dropped the function; the
+ * stack bound then follows the emitted frames
+ */
+void setFrameSize(int f, int size);
+
+/* Procedure printFrames writes the frame of every
+ * reachable function and the data memory the
+ * program needs to the listing
+ */
+void printFrames(void);
+
+#endif
@@ -121,6 +121,11 @@ typedef struct treeNode {
         char *name;
     } attr;
     ExpType type; /* for type checking of exps */
+    struct treeNode *decl; /* IdK, AssignK, CallK: declaration the name refers to */
+    int scope; /* declarations: nesting depth, 0 = global */
+    int memloc; /* declarations: gp offset of a global, mp offset of a local */
+    int regs; /* OpK: Sethi-Ullman number, set by labelTree */
+    int calls; /* expressions: TRUE if a call is inside, set by labelTree */
 } TreeNode;
 
 /**************************************************/
@@ -155,6 +160,25 @@ extern int TraceAnalyze;
  */
 extern int TraceCode;
 
+/* TraceOpt = TRUE causes the optimization passes
+ * to report what they changed to the listing file
+ */
+extern int TraceOpt;
+
+/* TraceIR = TRUE causes the intermediate code to
+ * be printed to the listing file before code
+ * generation
+ */
+extern int TraceIR;
+
 /* Error = TRUE prevents further passes if an error occurs */
 extern int Error;
+
+/* Relocatable = TRUE makes the compiler write a
+ * relocatable object for tmlink instead of a
+ * program: every function stays an entry, and
+ * calls to functions of other modules are left
+ * to the linker
+ */
+extern int Relocatable;
 #endif
@@ -0,0 +1,219 @@
+/****************************************************/
+/* File: gvn.c                                      */
+/* Dominator-based value numbering of the IR for    */
+/* the C-- compiler                                 */
+/****************************************************/
+
+#include "globals.h"
+#include "ir.h"
+#include "ssa.h"
+#include "pure.h"
+#include "gvn.h"
+
+/* BUCKETS = size of the hash table of the
+ * available expressions
+ */
+#define BUCKETS 211
+
+/* an available expression: op applied to the
+ * value numbers a and b, computed into value;
+ * a load of global g in memory version v is the
+ * entry (IrLoad, g, v)
+ */
+typedef struct
+{
+    IrOp op;
+    IrOperand a, b;
+    IrOperand value;
+    int next; /* next entry of the bucket, or -1 */
+} Entry;
+
+static Entry *table = NULL;
+static int ntable = 0, maxtable = 0;
+static int buckets[BUCKETS];
+
+static IrOperand *vn = NULL; /* value number of each temporary */
+static int nsyms = 0;        /* globals of the program */
+static int generation = 0;   /* last memory version handed out */
+static int *firstKid = NULL, *nextKid = NULL; /* the dominator tree */
+static IrFunc *fn = NULL;
+static int replaced = 0;
+
+static IrOperand canon(IrOperand o)
+{
+    return o.kind == OpdTemp ? vn[o.val] : o;
+}
+
+static int same(IrOperand x, IrOperand y)
+{
+    return x.kind == y.kind && x.val == y.val;
+}
+
+static int hash(IrOp op, IrOperand a, IrOperand b)
+{
+    unsigned h = op;
+    h = h * 31 + a.kind * 7 + (unsigned)a.val;
+    h = h * 31 + b.kind * 7 + (unsigned)b.val;
+    return h % BUCKETS;
+}
+
+static Entry *lookup(IrOp op, IrOperand a, IrOperand b)
+{
+    int e;
+    for (e = buckets[hash(op, a, b)]; e >= 0; e = table[e].next)
+        if (table[e].op == op && same(table[e].a, a) && same(table[e].b, b))
+            return &table[e];
+    return NULL;
+}
+
+static void insert(IrOp op, IrOperand a, IrOperand b, IrOperand value)
+{
+    int h = hash(op, a, b);
+    if (ntable == maxtable)
+    {
+        maxtable = maxtable ? 2 * maxtable : 64;
+        table = realloc(table, maxtable * sizeof(Entry));
+    }
+    table[ntable].op = op;
+    table[ntable].a = a;
+    table[ntable].b = b;
+    table[ntable].value = value;
+    table[ntable].next = buckets[h];
+    buckets[h] = ntable++;
+}
+
+/* Procedure popTo removes the entries added since
+ * the table had mark entries
+ */
+static void popTo(int mark)
+{
+    while (ntable > mark)
+    {
+        ntable--;
+        buckets[hash(table[ntable].op, table[ntable].a, table[ntable].b)] = table[ntable].next;
+    }
+}
+
+static int commutative(IrOp op)
+{
+    return op == IrAdd || op == IrMul || op == IrEq || op == IrNe;
+}
+
+/* Procedure replace turns i into a copy of value */
+static void replace(IrInstr *i, IrOperand value)
+{
+    i->op = IrMov;
+    i->a = value;
+    i->b = irNone();
+    vn[i->dst.val] = value;
+    replaced++;
+}
+
+/* Procedure numberBlock numbers the instructions
+ * of b and then of the blocks it dominates; ver
+ * holds the memory version of every global on
+ * entry, or is NULL when b is entered from more
+ * than its dominator and memory must be assumed
+ * changed
+ */
+static void numberBlock(IrBlock *b, int *ver)
+{
+    int mark = ntable, k;
+    int *cur = (int *)malloc((nsyms + 1) * sizeof(int));
+    IrInstr *i;
+    for (k = 0; k < nsyms; k++)
+        cur[k] = ver != NULL ? ver[k] : ++generation;
+    for (i = b->first; i != NULL; i = i->next)
+    {
+        IrOperand x = canon(i->a), y = canon(i->b);
+        Entry *e;
+        switch (i->op)
+        {
+        case IrMov:
+            vn[i->dst.val] = x;
+            break;
+        case IrAdd:
+        case IrSub:
+        case IrMul:
+        case IrDiv:
+        case IrLt:
+        case IrLe:
+        case IrGt:
+        case IrGe:
+        case IrEq:
+        case IrNe:
+            if (commutative(i->op) &&
+                (x.kind > y.kind || (x.kind == y.kind && x.val > y.val)))
+            {
+                IrOperand t = x;
+                x = y;
+                y = t;
+            }
+            e = lookup(i->op, x, y);
+            if (e != NULL)
+                replace(i, e->value);
+            else
+                insert(i->op, x, y, i->dst);
+            break;
+        case IrLoad:
+            if (i->sym >= nsyms)
+                break;
+            e = lookup(IrLoad, irConst(i->sym), irConst(cur[i->sym]));
+            if (e != NULL)
+                replace(i, e->value);
+            else
+                insert(IrLoad, irConst(i->sym), irConst(cur[i->sym]), i->dst);
+            break;
+        case IrStore:
+            if (i->sym >= nsyms)
+                break;
+            /* a later load reads back the value stored */
+            cur[i->sym] = ++generation;
+            insert(IrLoad, irConst(i->sym), irConst(cur[i->sym]), x);
+            break;
+        case IrCall:
+            if (!isPureFunction(i->callee))
+                for (k = 0; k < nsyms; k++)
+                    cur[k] = ++generation;
+            break;
+        default:
+            break;
+        }
+    }
+    for (k = firstKid[b->id]; k >= 0; k = nextKid[k])
+    {
+        IrBlock *c = fn->blocks[k];
+        numberBlock(c, c->npred == 1 ? cur : NULL);
+    }
+    popTo(mark);
+    free(cur);
+}
+
+int numberValues(IrProgram *p, IrFunc *f)
+{
+    int k, t;
+    fn = f;
+    nsyms = p->nglobals;
+    replaced = 0;
+    computeDominators(f);
+    vn = realloc(vn, (f->ntemps + 1) * sizeof(IrOperand));
+    for (t = 0; t < f->ntemps; t++)
+        vn[t] = irTemp(t);
+    firstKid = realloc(firstKid, (f->nblocks + 1) * sizeof(int));
+    nextKid = realloc(nextKid, (f->nblocks + 1) * sizeof(int));
+    for (k = 0; k < f->nblocks; k++)
+        firstKid[k] = -1;
+    for (k = f->nblocks - 1; k > 0; k--)
+    {
+        IrBlock *d = f->blocks[k]->idom;
+        if (d == NULL)
+            continue;
+        nextKid[k] = firstKid[d->id];
+        firstKid[d->id] = k;
+    }
+    for (k = 0; k < BUCKETS; k++)
+        buckets[k] = -1;
+    ntable = 0;
+    numberBlock(f->blocks[0], NULL);
+    return replaced;
+}
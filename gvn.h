@@ -0,0 +1,22 @@
+/****************************************************/
+/* File: gvn.h                                      */
+/* Dominator-based value numbering of the IR for    */
+/* the C-- compiler                                 */
+/****************************************************/
+
+#ifndef _GVN_H_
+#define _GVN_H_
+
+#include "ir.h"
+
+/* Function numberValues finds the computations of
+ * f (in SSA form) that repeat one made earlier in
+ * the same block or in a dominating one and turns
+ * them into copies of its result. Loads of globals
+ * are numbered too, until a store to the global or
+ * a call to an impure function. It returns the
+ * number of computations replaced
+ */
+int numberValues(IrProgram *p, IrFunc *f);
+
+#endif
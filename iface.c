@@ -0,0 +1,196 @@
+/****************************************************/
+/* File: iface.c                                    */
+/* Interface (.cmi) files for separate compilation  */
+/* of C-- programs                                  */
+/****************************************************/
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "globals.h"
+#include "util.h"
+#include "symtab.h"
+#include "iface.h"
+
+/* Function writeInterface writes the interface of
+ * the functions and global variables declared in
+ * syntaxTree to filename
+ */
+int writeInterface(TreeNode *syntaxTree, char *filename)
+{
+    IfaceHeader h;
+    IfaceFunc *funcs;
+    IfaceVar *vars;
+    unsigned char *ptypes;
+    char *strings;
+    TreeNode *t;
+    FILE *fp;
+    int ok;
+
+    h.magic = IFACE_MAGIC;
+    h.version = IFACE_VERSION;
+    h.nfuncs = h.nvars = h.nptypes = h.strsize = 0;
+    for (t = syntaxTree; t != NULL; t = t->sibling)
+    {
+        if (t->nodekind != StmtK)
+            continue;
+        if (t->kind.stmt == FuncDeclarationK)
+        {
+            h.nfuncs++;
+            h.nptypes += paramCount(t->child[0]);
+        }
+        else if (t->kind.stmt == VarDeclarationK)
+            h.nvars++;
+        else
+            continue;
+        h.strsize += strlen(t->attr.name) + 1;
+    }
+    funcs = malloc((h.nfuncs + 1) * sizeof(IfaceFunc));
+    vars = malloc((h.nvars + 1) * sizeof(IfaceVar));
+    ptypes = malloc(h.nptypes + 1);
+    strings = malloc(h.strsize + 1);
+    h.nfuncs = h.nvars = h.nptypes = h.strsize = 0;
+    for (t = syntaxTree; t != NULL; t = t->sibling)
+    {
+        int name = h.strsize;
+        if (t->nodekind != StmtK)
+            continue;
+        if (t->kind.stmt == FuncDeclarationK)
+        {
+            IfaceFunc *f = &funcs[h.nfuncs++];
+            TreeNode *p;
+            f->name = name;
+            f->rettype = t->type;
+            f->nparams = paramCount(t->child[0]);
+            f->ptypes = h.nptypes;
+            for (p = t->child[0]; p != NULL && f->nparams > 0; p = p->sibling)
+                ptypes[h.nptypes++] = (unsigned char)p->type;
+        }
+        else if (t->kind.stmt == VarDeclarationK)
+        {
+            vars[h.nvars].name = name;
+            vars[h.nvars].type = t->type;
+            h.nvars++;
+        }
+        else
+            continue;
+        strcpy(strings + h.strsize, t->attr.name);
+        h.strsize += strlen(t->attr.name) + 1;
+    }
+    fp = fopen(filename, "wb");
+    ok = fp != NULL;
+    if (ok)
+    {
+        ok = fwrite(&h, sizeof(h), 1, fp) == 1;
+        ok = ok && fwrite(funcs, sizeof(IfaceFunc), h.nfuncs, fp) == (size_t)h.nfuncs;
+        ok = ok && fwrite(vars, sizeof(IfaceVar), h.nvars, fp) == (size_t)h.nvars;
+        ok = ok && fwrite(ptypes, 1, h.nptypes, fp) == (size_t)h.nptypes;
+        ok = ok && fwrite(strings, 1, h.strsize, fp) == (size_t)h.strsize;
+        ok = (fclose(fp) == 0) && ok;
+    }
+    free(funcs);
+    free(vars);
+    free(ptypes);
+    free(strings);
+    return ok;
+}
+
+/* Function validName returns whether the name at
+ * offset off of the string table is terminated
+ * within its strsize bytes
+ */
+static int validName(const char *strings, int strsize, int off)
+{
+    return off >= 0 && off < strsize && memchr(strings + off, '\0', strsize - off) != NULL;
+}
+
+/* Function validType returns TRUE if type is an
+ * ExpType
+ */
+static int validType(int type)
+{
+    return type >= Void && type <= Boolean;
+}
+
+/* Function loadInterface maps filename into memory
+ * and enters its functions and global variables
+ * into the symbol table. The mapping is never
+ * released: the symbol table points into it.
+ */
+int loadInterface(char *filename)
+{
+    struct stat sb;
+    const IfaceHeader *h;
+    const IfaceFunc *funcs;
+    const IfaceVar *vars;
+    const unsigned char *ptypes;
+    char *strings;
+    char *base;
+    size_t need;
+    int fd, i, j = 0, k;
+
+    fd = open(filename, O_RDONLY);
+    if (fd < 0)
+        return FALSE;
+    if (fstat(fd, &sb) < 0 || (size_t)sb.st_size < sizeof(IfaceHeader))
+    {
+        close(fd);
+        return FALSE;
+    }
+    base = mmap(NULL, sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED)
+        return FALSE;
+    h = (const IfaceHeader *)base;
+    need = sizeof(IfaceHeader) + h->nfuncs * sizeof(IfaceFunc) +
+           h->nvars * sizeof(IfaceVar) + h->nptypes + h->strsize;
+    if (h->magic != IFACE_MAGIC || h->version != IFACE_VERSION ||
+        h->nfuncs < 0 || h->nvars < 0 || h->nptypes < 0 || h->strsize <= 0 ||
+        need != (size_t)sb.st_size || base[sb.st_size - 1] != '\0')
+    {
+        munmap(base, sb.st_size);
+        return FALSE;
+    }
+    funcs = (const IfaceFunc *)(h + 1);
+    vars = (const IfaceVar *)(funcs + h->nfuncs);
+    ptypes = (const unsigned char *)(vars + h->nvars);
+    strings = (char *)(ptypes + h->nptypes);
+    /* check every record before entering any, so
+     * that a bad file leaves the table untouched */
+    for (i = 0; i < h->nfuncs; i++)
+        if (!validName(strings, h->strsize, funcs[i].name) ||
+            funcs[i].ptypes < 0 || funcs[i].nparams < 0 ||
+            funcs[i].ptypes > h->nptypes ||
+            funcs[i].nparams > h->nptypes - funcs[i].ptypes ||
+            !validType(funcs[i].rettype))
+            break;
+    for (k = 0; k < h->nptypes; k++)
+        if (!validType(ptypes[k]))
+            break;
+    for (j = 0; i == h->nfuncs && k == h->nptypes && j < h->nvars; j++)
+        if (!validName(strings, h->strsize, vars[j].name) || !validType(vars[j].type))
+            break;
+    if (i < h->nfuncs || k < h->nptypes || j < h->nvars)
+    {
+        munmap(base, sb.st_size);
+        return FALSE;
+    }
+    for (i = 0; i < h->nfuncs; i++)
+    {
+        char *name = strings + funcs[i].name;
+        st_insert(name, 0, -1, FUNC);
+        st_set_signature(name, funcs[i].rettype, funcs[i].nparams,
+                         ptypes + funcs[i].ptypes, TRUE);
+    }
+    for (i = 0; i < h->nvars; i++)
+    {
+        char *name = strings + vars[i].name;
+        st_insert(name, 0, -1, VAR);
+        st_set_imported(name);
+    }
+    if (TraceAnalyze)
+        fprintf(listing, "Imported %d functions and %d variables from %s\n",
+                h->nfuncs, h->nvars, filename);
+    return TRUE;
+}
@@ -0,0 +1,65 @@
+/****************************************************/
+/* File: iface.h                                    */
+/* Interface (.cmi) files for separate compilation  */
+/* of C-- programs                                  */
+/****************************************************/
+
+#ifndef _IFACE_H_
+#define _IFACE_H_
+
+/* An interface file holds everything another
+ * translation unit needs to type-check calls
+ * into this one. All fields are ints in the
+ * byte order of the compiling machine:
+ *
+ *   IfaceHeader
+ *   IfaceFunc     funcs[nfuncs]
+ *   IfaceVar      vars[nvars]
+ *   unsigned char ptypes[nptypes]   parameter types
+ *   char          strings[strsize]  NUL-terminated names
+ *
+ * Names and parameter types are referenced by
+ * offset, so a mapped file is used in place.
+ */
+#define IFACE_MAGIC 0x494d4321 /* "!CMI" */
+#define IFACE_VERSION 1
+
+typedef struct
+{
+    int magic;
+    int version;
+    int nfuncs;
+    int nvars;
+    int nptypes;
+    int strsize;
+} IfaceHeader;
+
+typedef struct
+{
+    int name;    /* offset into strings */
+    int rettype; /* an ExpType */
+    int nparams;
+    int ptypes;  /* offset into ptypes */
+} IfaceFunc;
+
+typedef struct
+{
+    int name;
+    int type;
+} IfaceVar;
+
+/* Function writeInterface writes the interface of
+ * the functions and global variables declared in
+ * syntaxTree to filename; it returns FALSE if the
+ * file cannot be written
+ */
+int writeInterface(TreeNode *syntaxTree, char *filename);
+
+/* Function loadInterface maps filename into memory
+ * and enters its functions and global variables
+ * into the symbol table; it returns FALSE if the
+ * file cannot be read or is not an interface file
+ */
+int loadInterface(char *filename);
+
+#endif
@@ -0,0 +1,246 @@
+/****************************************************/
+/* File: inline.c                                   */
+/* Inlining of calls in the IR for the C-- compiler */
+/****************************************************/
+
+#include "globals.h"
+#include "ir.h"
+#include "callgraph.h"
+#include "inline.h"
+
+static IrFunc **funcs = NULL; /* the functions, callees before callers */
+static int nfuncs = 0;
+static int *sites = NULL;     /* calls left to each function */
+static int budget = 0;        /* instructions inlining may still add */
+
+static int funcIndex(char *name)
+{
+    int k;
+    for (k = 0; k < nfuncs; k++)
+        if (strcmp(funcs[k]->name, name) == 0)
+            return k;
+    return -1;
+}
+
+static IrFunc **order = NULL;
+static int norder = 0;
+
+/* Procedure postorder lists f after the
+ * functions it calls
+ */
+static void postorder(IrFunc *f, char *seen, IrFunc **all, int nall)
+{
+    int k;
+    for (k = 0; k < nall && all[k] != f; k++)
+        ;
+    if (seen[k])
+        return;
+    seen[k] = TRUE;
+    for (k = 0; k < f->nblocks; k++)
+    {
+        IrInstr *i;
+        for (i = f->blocks[k]->first; i != NULL; i = i->next)
+        {
+            int c;
+            if (i->op != IrCall)
+                continue;
+            for (c = 0; c < nall && strcmp(all[c]->name, i->callee) != 0; c++)
+                ;
+            if (c < nall)
+                postorder(all[c], seen, all, nall);
+        }
+    }
+    order[norder++] = f;
+}
+
+static IrOperand shift(IrOperand o, int base)
+{
+    if (o.kind == OpdTemp)
+        o.val += base;
+    return o;
+}
+
+/* Function copyInstr returns a copy of i with
+ * its temporaries moved up by base
+ */
+static IrInstr *copyInstr(IrInstr *i, int base)
+{
+    IrInstr *c = irNewInstr(i->op, shift(i->dst, base), shift(i->a, base), shift(i->b, base));
+    int k;
+    c->sym = i->sym;
+    c->callee = i->callee;
+    c->lineno = i->lineno;
+    c->cmp = i->cmp;
+    c->nargs = i->nargs;
+    if (i->nargs > 0)
+    {
+        c->args = (IrOperand *)malloc(i->nargs * sizeof(IrOperand));
+        for (k = 0; k < i->nargs; k++)
+            c->args[k] = shift(i->args[k], base);
+    }
+    return c;
+}
+
+/* Function worthInlining applies the cost model
+ * to the call i of callee
+ */
+static int worthInlining(IrInstr *i, int callee)
+{
+    IrFunc *g = funcs[callee];
+    int size = irCountFuncInstrs(g), limit = INLINE_SIZE + i->nargs, k;
+    if (cg_recursive(cg_lookup(g->name)) || size > budget)
+        return FALSE;
+    for (k = 0; k < i->nargs; k++)
+        if (i->args[k].kind == OpdConst)
+            limit++;
+    return size <= limit || sites[callee] == 1;
+}
+
+/* Function inlineCall replaces the call i ending
+ * the first part of block b of f by the body of g:
+ * the rest of b moves to a new block, the
+ * arguments are copied to the callee's parameters
+ * (renumbered after the caller's temporaries) and
+ * every return becomes a copy of the result and
+ * a jump to that block, which is returned
+ */
+static IrBlock *inlineCall(IrFunc *f, IrBlock *b, IrInstr *i, IrFunc *g)
+{
+    IrBlock *after = irNewBlockAt(f, b->id + 1);
+    IrBlock **copy = (IrBlock **)malloc(g->nblocks * sizeof(IrBlock *));
+    int base = f->ntemps, k;
+    IrInstr *j;
+    f->ntemps += g->ntemps;
+    /* move the instructions after the call */
+    after->first = i->next;
+    after->last = b->last;
+    after->first->prev = NULL;
+    irSetSuccs(after, b->succ[0], b->succ[1]);
+    i->next = NULL;
+    b->last = i;
+    irRemove(b, i);
+    for (k = 0; k < g->nblocks; k++)
+        copy[k] = irNewBlockAt(f, after->id);
+    for (k = 0; k < g->nparams; k++)
+    {
+        j = irNewInstr(IrMov, irTemp(base + k), i->args[k], irNone());
+        j->lineno = i->lineno;
+        irAppend(b, j);
+    }
+    irAppend(b, irNewInstr(IrJump, irNone(), irNone(), irNone()));
+    irSetSuccs(b, copy[0], NULL);
+    for (k = 0; k < g->nblocks; k++)
+    {
+        IrBlock *s = g->blocks[k];
+        for (j = s->first; j != NULL; j = j->next)
+        {
+            IrInstr *c;
+            int callee;
+            if (j->op == IrReturn)
+            {
+                if (i->dst.kind != OpdNone && j->a.kind != OpdNone)
+                {
+                    c = irNewInstr(IrMov, i->dst, shift(j->a, base), irNone());
+                    c->lineno = j->lineno;
+                    irAppend(copy[k], c);
+                }
+                irAppend(copy[k], irNewInstr(IrJump, irNone(), irNone(), irNone()));
+                irSetSuccs(copy[k], after, NULL);
+                continue;
+            }
+            irAppend(copy[k], copyInstr(j, base));
+            if (j->op == IrCall && (callee = funcIndex(j->callee)) >= 0)
+                sites[callee]++;
+        }
+        if (s->last->op != IrReturn)
+            irSetSuccs(copy[k], copy[s->succ[0]->id],
+                       s->nsucc > 1 ? copy[s->succ[1]->id] : NULL);
+    }
+    free(copy);
+    return after;
+}
+
+/* Function inlineFunc inlines the calls of f
+ * worth it and returns their number
+ */
+static int inlineFunc(IrFunc *f)
+{
+    int k, n = 0;
+    for (k = 0; k < f->nblocks; k++)
+    {
+        IrBlock *b = f->blocks[k];
+        IrInstr *i = b->first;
+        while (i != NULL)
+        {
+            int callee;
+            if (i->op != IrCall || (callee = funcIndex(i->callee)) < 0 ||
+                funcs[callee] == f || !worthInlining(i, callee))
+            {
+                i = i->next;
+                continue;
+            }
+            if (TraceOpt)
+                fprintf(listing, "%s: inlined %s at line %d, %d instructions\n",
+                        f->name, i->callee, i->lineno, irCountFuncInstrs(funcs[callee]));
+            budget -= irCountFuncInstrs(funcs[callee]);
+            sites[callee]--;
+            n++;
+            /* go on with the rest of b, past the copied body */
+            b = inlineCall(f, b, i, funcs[callee]);
+            k = b->id;
+            i = b->first;
+        }
+    }
+    irBuildCFG(f);
+    return n;
+}
+
+int inlineCalls(IrProgram *p, int growth)
+{
+    IrFunc *f, **link;
+    char *seen;
+    int k, n = 0;
+    nfuncs = 0;
+    for (f = p->funcs; f != NULL; f = f->next)
+        nfuncs++;
+    funcs = realloc(funcs, (nfuncs + 1) * sizeof(IrFunc *));
+    order = realloc(order, (nfuncs + 1) * sizeof(IrFunc *));
+    sites = realloc(sites, (nfuncs + 1) * sizeof(int));
+    seen = (char *)calloc(nfuncs + 1, 1);
+    for (k = 0, f = p->funcs; f != NULL; f = f->next)
+        funcs[k++] = f;
+    norder = 0;
+    for (k = 0; k < nfuncs; k++)
+        postorder(funcs[k], seen, funcs, nfuncs);
+    memcpy(funcs, order, nfuncs * sizeof(IrFunc *));
+    free(seen);
+    for (k = 0; k < nfuncs; k++)
+        sites[k] = 0;
+    for (f = p->funcs; f != NULL; f = f->next)
+        for (k = 0; k < f->nblocks; k++)
+        {
+            IrInstr *i;
+            int c;
+            for (i = f->blocks[k]->first; i != NULL; i = i->next)
+                if (i->op == IrCall && (c = funcIndex(i->callee)) >= 0)
+                    sites[c]++;
+        }
+    budget = irCountInstrs(p) * growth / 100;
+    if (TraceOpt)
+        fprintf(listing, "\nInlining:\n");
+    for (k = 0; k < nfuncs; k++)
+        n += inlineFunc(funcs[k]);
+    /* drop the functions nothing calls any more; the
+     * functions of an object can be called from other
+     * modules, and so can those of a library
+     */
+    for (link = &p->funcs; *link != NULL && !Relocatable && funcIndex("main") >= 0;)
+        if (sites[funcIndex((*link)->name)] == 0 && strcmp((*link)->name, "main") != 0)
+            *link = (*link)->next;
+        else
+            link = &(*link)->next;
+    if (TraceOpt)
+        fprintf(listing, "%d calls inlined, %d instructions after inlining\n",
+                n, irCountInstrs(p));
+    return n;
+}
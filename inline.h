@@ -0,0 +1,34 @@
+/****************************************************/
+/* File: inline.h                                   */
+/* Inlining of calls in the IR for the C-- compiler */
+/****************************************************/
+
+#ifndef _INLINE_H_
+#define _INLINE_H_
+
+#include "ir.h"
+
+/* INLINE_SIZE = the number of IR instructions a
+ * callee may have and still always be inlined;
+ * every argument and every constant argument
+ * raise it by one, since they turn into copies
+ * that later passes fold away
+ */
+#define INLINE_SIZE 12
+
+/* INLINE_GROWTH = the default percentage by which
+ * inlining may grow the program
+ */
+#define INLINE_GROWTH 50
+
+/* Function inlineCalls replaces the calls of
+ * small non-recursive functions, and of functions
+ * called only once, by a copy of the callee's
+ * body, callees before callers, as long as the
+ * program grows by at most growth percent;
+ * functions no longer called are dropped. It
+ * returns the number of calls inlined
+ */
+int inlineCalls(IrProgram *p, int growth);
+
+#endif
@@ -0,0 +1,556 @@
+/****************************************************/
+/* File: ir.c                                       */
+/* Three-address intermediate representation and   */
+/* control-flow graph for the C-- compiler          */
+/****************************************************/
+
+#include "globals.h"
+#include "fold.h"
+#include "ir.h"
+
+IrOperand irNone(void)
+{
+    IrOperand o;
+    o.kind = OpdNone;
+    o.val = 0;
+    return o;
+}
+
+IrOperand irTemp(int t)
+{
+    IrOperand o;
+    o.kind = OpdTemp;
+    o.val = t;
+    return o;
+}
+
+IrOperand irConst(int c)
+{
+    IrOperand o;
+    o.kind = OpdConst;
+    o.val = c;
+    return o;
+}
+
+int irNewTemp(IrFunc *f)
+{
+    return f->ntemps++;
+}
+
+IrFunc *irNewFunc(char *name, int nparams)
+{
+    IrFunc *f = (IrFunc *)malloc(sizeof(IrFunc));
+    f->name = name;
+    f->nparams = nparams;
+    f->ntemps = nparams;
+    f->returnsValue = FALSE;
+    f->blocks = NULL;
+    f->nblocks = f->maxblocks = 0;
+    f->reg = f->slot = NULL;
+    f->saveBase = 0;
+    f->frameSize = 0;
+    f->next = NULL;
+    return f;
+}
+
+IrBlock *irNewBlock(IrFunc *f)
+{
+    IrBlock *b = (IrBlock *)malloc(sizeof(IrBlock));
+    b->first = b->last = NULL;
+    b->succ[0] = b->succ[1] = NULL;
+    b->nsucc = 0;
+    b->pred = NULL;
+    b->npred = b->maxpred = 0;
+    b->mark = 0;
+    b->idom = NULL;
+    b->domDepth = 0;
+    b->rpo = 0;
+    if (f->nblocks == f->maxblocks)
+    {
+        f->maxblocks = f->maxblocks ? 2 * f->maxblocks : 8;
+        f->blocks = realloc(f->blocks, f->maxblocks * sizeof(IrBlock *));
+    }
+    b->id = f->nblocks;
+    f->blocks[f->nblocks++] = b;
+    return b;
+}
+
+IrBlock *irNewBlockAt(IrFunc *f, int pos)
+{
+    IrBlock *b = irNewBlock(f);
+    int k;
+    for (k = f->nblocks - 1; k > pos; k--)
+    {
+        f->blocks[k] = f->blocks[k - 1];
+        f->blocks[k]->id = k;
+    }
+    f->blocks[pos] = b;
+    b->id = pos;
+    return b;
+}
+
+IrInstr *irNewInstr(IrOp op, IrOperand dst, IrOperand a, IrOperand b)
+{
+    IrInstr *i = (IrInstr *)malloc(sizeof(IrInstr));
+    i->op = op;
+    i->dst = dst;
+    i->a = a;
+    i->b = b;
+    i->sym = 0;
+    i->callee = NULL;
+    i->args = NULL;
+    i->nargs = 0;
+    i->lineno = 0;
+    i->mark = 0;
+    i->saved = 0;
+    i->cmp = IrNe;
+    i->prev = i->next = NULL;
+    return i;
+}
+
+void irAppend(IrBlock *b, IrInstr *i)
+{
+    i->prev = b->last;
+    i->next = NULL;
+    if (b->last != NULL)
+        b->last->next = i;
+    else
+        b->first = i;
+    b->last = i;
+}
+
+void irSetSuccs(IrBlock *b, IrBlock *s0, IrBlock *s1)
+{
+    b->succ[0] = s0;
+    b->succ[1] = s1;
+    b->nsucc = (s0 != NULL) + (s1 != NULL);
+}
+
+void irInsertBefore(IrBlock *b, IrInstr *pos, IrInstr *i)
+{
+    if (pos == NULL)
+    {
+        irAppend(b, i);
+        return;
+    }
+    i->next = pos;
+    i->prev = pos->prev;
+    if (pos->prev != NULL)
+        pos->prev->next = i;
+    else
+        b->first = i;
+    pos->prev = i;
+}
+
+void irRemove(IrBlock *b, IrInstr *i)
+{
+    if (i->prev != NULL)
+        i->prev->next = i->next;
+    else
+        b->first = i->next;
+    if (i->next != NULL)
+        i->next->prev = i->prev;
+    else
+        b->last = i->prev;
+    i->prev = i->next = NULL;
+}
+
+int irIsTerminator(IrOp op)
+{
+    return op == IrJump || op == IrBranch || op == IrReturn;
+}
+
+int irHasSideEffects(IrInstr *i)
+{
+    switch (i->op)
+    {
+    case IrStore:
+    case IrIn:
+    case IrOut:
+    case IrCall:
+    case IrJump:
+    case IrBranch:
+    case IrReturn:
+        return TRUE;
+    case IrDiv: /* may trap on division by zero */
+        return !(i->b.kind == OpdConst && i->b.val != 0);
+    default:
+        return FALSE;
+    }
+}
+
+int irUses(IrInstr *i, int *uses)
+{
+    int n = 0, k;
+    if (i->a.kind == OpdTemp)
+        uses[n++] = i->a.val;
+    if (i->b.kind == OpdTemp)
+        uses[n++] = i->b.val;
+    for (k = 0; k < i->nargs; k++)
+        if (i->args[k].kind == OpdTemp)
+            uses[n++] = i->args[k].val;
+    return n;
+}
+
+int irDef(IrInstr *i)
+{
+    return i->dst.kind == OpdTemp ? i->dst.val : -1;
+}
+
+static void addPred(IrBlock *b, IrBlock *p)
+{
+    if (b->npred == b->maxpred)
+    {
+        b->maxpred = b->maxpred ? 2 * b->maxpred : 4;
+        b->pred = realloc(b->pred, b->maxpred * sizeof(IrBlock *));
+    }
+    b->pred[b->npred++] = p;
+}
+
+static void markFrom(IrBlock *b)
+{
+    int i;
+    if (b->mark)
+        return;
+    b->mark = TRUE;
+    for (i = 0; i < b->nsucc; i++)
+        markFrom(b->succ[i]);
+}
+
+/* Procedure reorderPhis makes the arguments of
+ * the phis of b follow its new predecessor list;
+ * old holds the nold predecessors the arguments
+ * were written for
+ */
+static void reorderPhis(IrBlock *b, IrBlock **old, int nold)
+{
+    IrInstr *i;
+    int j, k;
+    int *from = (int *)malloc((b->npred + 1) * sizeof(int));
+    char *taken = (char *)calloc(nold + 1, 1);
+    for (j = 0; j < b->npred; j++)
+    {
+        from[j] = -1;
+        for (k = 0; k < nold; k++)
+            if (!taken[k] && old[k] == b->pred[j])
+            {
+                from[j] = k;
+                taken[k] = TRUE;
+                break;
+            }
+    }
+    for (i = b->first; i != NULL && i->op == IrPhi; i = i->next)
+    {
+        IrOperand *args = (IrOperand *)malloc((b->npred + 1) * sizeof(IrOperand));
+        for (j = 0; j < b->npred; j++)
+            args[j] = from[j] >= 0 ? i->args[from[j]] : irNone();
+        i->args = args;
+        i->nargs = b->npred;
+    }
+    free(from);
+    free(taken);
+}
+
+/* Procedure irBuildCFG recomputes the predecessor
+ * lists of f from the successors, drops the blocks
+ * that cannot be reached from the entry and
+ * renumbers the rest in code order; the arguments
+ * of phis follow their predecessors
+ */
+void irBuildCFG(IrFunc *f)
+{
+    int i, j, n = 0;
+    IrBlock ***old = (IrBlock ***)malloc((f->nblocks + 1) * sizeof(IrBlock **));
+    for (i = 0; i < f->nblocks; i++)
+    {
+        f->blocks[i]->mark = FALSE;
+        f->blocks[i]->npred = 0;
+    }
+    if (f->nblocks > 0)
+        markFrom(f->blocks[0]);
+    for (i = 0; i < f->nblocks; i++)
+        if (f->blocks[i]->mark)
+        {
+            f->blocks[n] = f->blocks[i];
+            f->blocks[n]->id = n;
+            n++;
+        }
+    f->nblocks = n;
+    for (i = 0; i < n; i++)
+    {
+        IrBlock *b = f->blocks[i];
+        old[i] = b->pred;
+        b->pred = NULL;
+        b->maxpred = 0;
+    }
+    for (i = 0; i < n; i++)
+        for (j = 0; j < f->blocks[i]->nsucc; j++)
+            addPred(f->blocks[i]->succ[j], f->blocks[i]);
+    for (i = 0; i < n; i++)
+    {
+        IrBlock *b = f->blocks[i];
+        if (b->first != NULL && b->first->op == IrPhi)
+            reorderPhis(b, old[i], b->first->nargs);
+        free(old[i]);
+        b->mark = 0;
+    }
+    free(old);
+}
+
+/* Function skipEmpty returns the block a jump to
+ * b ends up in, following blocks that only jump
+ */
+static IrBlock *skipEmpty(IrFunc *f, IrBlock *b)
+{
+    int hops = 0;
+    while (b->first != NULL && b->first->op == IrJump && b->succ[0] != b &&
+           hops++ < f->nblocks)
+        b = b->succ[0];
+    return b;
+}
+
+/* Procedure irSimplifyCFG retargets the edges to
+ * blocks that only jump and merges every block
+ * into its predecessor when that is its only one;
+ * f must not contain phis
+ */
+void irSimplifyCFG(IrFunc *f)
+{
+    int k, j, changed = TRUE;
+    for (k = 0; k < f->nblocks; k++)
+        for (j = 0; j < f->blocks[k]->nsucc; j++)
+            f->blocks[k]->succ[j] = skipEmpty(f, f->blocks[k]->succ[j]);
+    irBuildCFG(f);
+    while (changed)
+    {
+        changed = FALSE;
+        for (k = 0; k < f->nblocks; k++)
+        {
+            IrBlock *b = f->blocks[k];
+            IrBlock *s = b->succ[0];
+            if (b->nsucc != 1 || s == b || s == f->blocks[0] || s->npred != 1 ||
+                b->last->op != IrJump)
+                continue;
+            irRemove(b, b->last);
+            if (s->first != NULL)
+            {
+                if (b->last != NULL)
+                    b->last->next = s->first;
+                else
+                    b->first = s->first;
+                s->first->prev = b->last;
+                b->last = s->last;
+            }
+            irSetSuccs(b, s->succ[0], s->succ[1]);
+            s->first = s->last = NULL;
+            irSetSuccs(s, NULL, NULL);
+            changed = TRUE;
+        }
+        if (changed)
+            irBuildCFG(f);
+    }
+}
+
+int irCountFuncInstrs(IrFunc *f)
+{
+    int b, n = 0;
+    for (b = 0; b < f->nblocks; b++)
+    {
+        IrInstr *i;
+        for (i = f->blocks[b]->first; i != NULL; i = i->next)
+            n++;
+    }
+    return n;
+}
+
+int irCountInstrs(IrProgram *p)
+{
+    IrFunc *f;
+    int n = 0;
+    for (f = p->funcs; f != NULL; f = f->next)
+        n += irCountFuncInstrs(f);
+    return n;
+}
+
+IrOp irInvertCmp(IrOp cmp)
+{
+    switch (cmp)
+    {
+    case IrLt: return IrGe;
+    case IrLe: return IrGt;
+    case IrGt: return IrLe;
+    case IrGe: return IrLt;
+    case IrEq: return IrNe;
+    default: return IrEq;
+    }
+}
+
+int irFoldOp(IrOp op, int a, int b, int *result)
+{
+    static const TokenType tokens[] = {PLUS, MINUS, TIMES, OVER, LT, LE, RT, RE, EQ, NE};
+    if (op < IrAdd || op > IrNe)
+        return FALSE;
+    return foldOp(tokens[op - IrAdd], a, b, result);
+}
+
+/**************************************************/
+/***********   textual dump of the IR   ***********/
+/**************************************************/
+
+static void printOperand(FILE *out, IrOperand o)
+{
+    if (o.kind == OpdTemp)
+        fprintf(out, "t%d", o.val);
+    else if (o.kind == OpdConst)
+        fprintf(out, "%d", o.val);
+    else
+        fprintf(out, "_");
+}
+
+static char *opName(IrOp op)
+{
+    switch (op)
+    {
+    case IrAdd: return "+";
+    case IrSub: return "-";
+    case IrMul: return "*";
+    case IrDiv: return "/";
+    case IrLt: return "<";
+    case IrLe: return "<=";
+    case IrGt: return ">";
+    case IrGe: return ">=";
+    case IrEq: return "==";
+    case IrNe: return "!=";
+    default: return "?";
+    }
+}
+
+void irPrintInstr(FILE *out, IrProgram *p, IrBlock *b, IrInstr *i)
+{
+    int k;
+    fprintf(out, "    ");
+    switch (i->op)
+    {
+    case IrNop:
+        fprintf(out, "nop");
+        break;
+    case IrMov:
+        printOperand(out, i->dst);
+        fprintf(out, " = ");
+        printOperand(out, i->a);
+        break;
+    case IrLoad:
+        printOperand(out, i->dst);
+        if (p != NULL && i->sym < p->nglobals)
+            fprintf(out, " = load %s", p->globalNames[i->sym]);
+        else
+            fprintf(out, " = load @%d", i->sym);
+        break;
+    case IrStore:
+        if (p != NULL && i->sym < p->nglobals)
+            fprintf(out, "store %s, ", p->globalNames[i->sym]);
+        else
+            fprintf(out, "store @%d, ", i->sym);
+        printOperand(out, i->a);
+        break;
+    case IrIn:
+        printOperand(out, i->dst);
+        fprintf(out, " = in");
+        break;
+    case IrOut:
+        fprintf(out, "out ");
+        printOperand(out, i->a);
+        break;
+    case IrPhi:
+        printOperand(out, i->dst);
+        fprintf(out, " = phi(");
+        for (k = 0; k < i->nargs; k++)
+        {
+            fprintf(out, k > 0 ? ", B%d: " : "B%d: ", b->pred[k]->id);
+            printOperand(out, i->args[k]);
+        }
+        fprintf(out, ")");
+        break;
+    case IrCall:
+        if (i->dst.kind != OpdNone)
+        {
+            printOperand(out, i->dst);
+            fprintf(out, " = ");
+        }
+        fprintf(out, "call %s(", i->callee);
+        for (k = 0; k < i->nargs; k++)
+        {
+            if (k > 0)
+                fprintf(out, ", ");
+            printOperand(out, i->args[k]);
+        }
+        fprintf(out, ")");
+        break;
+    case IrJump:
+        fprintf(out, "jump B%d", b->succ[0]->id);
+        break;
+    case IrBranch:
+        fprintf(out, "br ");
+        printOperand(out, i->a);
+        fprintf(out, " %s ", opName(i->cmp));
+        printOperand(out, i->b);
+        fprintf(out, ", B%d, B%d", b->succ[0]->id, b->succ[1]->id);
+        break;
+    case IrReturn:
+        fprintf(out, "ret");
+        if (i->a.kind != OpdNone)
+        {
+            fprintf(out, " ");
+            printOperand(out, i->a);
+        }
+        break;
+    default:
+        printOperand(out, i->dst);
+        fprintf(out, " = ");
+        printOperand(out, i->a);
+        fprintf(out, " %s ", opName(i->op));
+        printOperand(out, i->b);
+        break;
+    }
+    fprintf(out, "\n");
+}
+
+static void printFunc(FILE *out, IrProgram *p, IrFunc *f)
+{
+    int k;
+    fprintf(out, "function %s(", f->name);
+    for (k = 0; k < f->nparams; k++)
+        fprintf(out, k > 0 ? ", t%d" : "t%d", k);
+    fprintf(out, ") temps=%d\n", f->ntemps);
+    for (k = 0; k < f->nblocks; k++)
+    {
+        IrBlock *b = f->blocks[k];
+        IrInstr *i;
+        int j;
+        fprintf(out, "  B%d:", b->id);
+        if (b->npred > 0)
+        {
+            fprintf(out, "    ; preds");
+            for (j = 0; j < b->npred; j++)
+                fprintf(out, " B%d", b->pred[j]->id);
+        }
+        fprintf(out, "\n");
+        for (i = b->first; i != NULL; i = i->next)
+            irPrintInstr(out, p, b, i);
+    }
+}
+
+void irPrintFunc(FILE *out, IrFunc *f)
+{
+    printFunc(out, NULL, f);
+}
+
+void irPrintProgram(FILE *out, IrProgram *p)
+{
+    IrFunc *f;
+    for (f = p->funcs; f != NULL; f = f->next)
+    {
+        printFunc(out, p, f);
+        fprintf(out, "\n");
+    }
+}
@@ -0,0 +1,207 @@
+/****************************************************/
+/* File: ir.h                                       */
+/* Three-address intermediate representation and   */
+/* control-flow graph for the C-- compiler          */
+/****************************************************/
+
+#ifndef _IR_H_
+#define _IR_H_
+
+/* IR operations. Every value lives in a numbered
+ * temporary of its function: temporaries
+ * 0 .. nparams-1 hold the parameters, then come
+ * the local variables and the compiler temporaries.
+ * Globals are only reached through IrLoad/IrStore.
+ * IrJump, IrBranch and IrReturn end a block and
+ * appear nowhere else; IrPhi only exists in SSA
+ * form and only at the start of a block.
+ */
+typedef enum
+{
+    IrNop,
+    IrMov,    /* dst = a */
+    IrAdd,    /* dst = a + b */
+    IrSub,    /* dst = a - b */
+    IrMul,    /* dst = a * b */
+    IrDiv,    /* dst = a / b */
+    IrLt,     /* dst = a < b (0 or 1) */
+    IrLe,     /* dst = a <= b */
+    IrGt,     /* dst = a > b */
+    IrGe,     /* dst = a >= b */
+    IrEq,     /* dst = a == b */
+    IrNe,     /* dst = a != b */
+    IrLoad,   /* dst = global sym */
+    IrStore,  /* global sym = a */
+    IrIn,     /* dst = input() */
+    IrOut,    /* output(a) */
+    IrCall,   /* dst = callee(args), dst may be none */
+    IrJump,   /* goto succ[0] */
+    IrBranch, /* if a cmp b goto succ[0] else succ[1] */
+    IrReturn, /* return a, a may be none */
+    IrPhi     /* dst = args[k] when entered from pred[k] */
+} IrOp;
+
+typedef enum
+{
+    OpdNone,
+    OpdTemp,
+    OpdConst
+} IrOperandKind;
+
+typedef struct
+{
+    IrOperandKind kind;
+    int val; /* temporary number or constant value */
+} IrOperand;
+
+typedef struct irInstr
+{
+    IrOp op;
+    IrOperand dst, a, b;
+    int sym;        /* IrLoad, IrStore: gp offset of the global;
+                       IrPhi: the variable before renaming */
+    char *callee;   /* IrCall: name of the function called */
+    IrOperand *args; /* IrCall: the arguments; IrPhi: one per pred */
+    int nargs;
+    int lineno;     /* source line, for listings */
+    int mark;       /* scratch for passes */
+    int saved;      /* IrCall: mask of the registers live across it */
+    IrOp cmp;       /* IrBranch: the comparison, IrLt .. IrNe */
+    struct irInstr *prev, *next;
+} IrInstr;
+
+typedef struct irBlock
+{
+    int id;                  /* index in the function's block array */
+    IrInstr *first, *last;   /* last is the terminator */
+    struct irBlock *succ[2];
+    int nsucc;
+    struct irBlock **pred;
+    int npred, maxpred;
+    int mark;                /* scratch for passes */
+    struct irBlock *idom;    /* immediate dominator, set by computeDominators */
+    int domDepth;            /* depth in the dominator tree */
+    int rpo;                 /* reverse postorder number */
+} IrBlock;
+
+typedef struct irFunc
+{
+    char *name;
+    int nparams;
+    int ntemps;
+    int returnsValue;
+    IrBlock **blocks;  /* blocks[0] is the entry; array order is code order */
+    int nblocks, maxblocks;
+    /* set by allocateRegisters; when reg is NULL every
+     * temporary t lives in frame word -1-t(mp)
+     */
+    int *reg;          /* register of each temporary, or -1 */
+    int *slot;         /* mp offset of each temporary not in a register */
+    int saveBase;      /* mp offset of the save area of register 2 */
+    int frameSize;
+    struct irFunc *next;
+} IrFunc;
+
+typedef struct
+{
+    IrFunc *funcs;
+    int nglobals;
+    char **globalNames; /* indexed by gp offset */
+} IrProgram;
+
+/* constructors */
+IrOperand irNone(void);
+IrOperand irTemp(int t);
+IrOperand irConst(int c);
+int irNewTemp(IrFunc *f);
+IrFunc *irNewFunc(char *name, int nparams);
+IrBlock *irNewBlock(IrFunc *f);
+IrInstr *irNewInstr(IrOp op, IrOperand dst, IrOperand a, IrOperand b);
+
+/* Function irNewBlockAt creates a block placed in
+ * code order just before blocks[pos], renumbering
+ * the blocks after it
+ */
+IrBlock *irNewBlockAt(IrFunc *f, int pos);
+
+/* Procedure irAppend adds instruction i at the end
+ * of block b; a terminator also sets the successors
+ * of b from s0 and s1 (which may be NULL)
+ */
+void irAppend(IrBlock *b, IrInstr *i);
+void irSetSuccs(IrBlock *b, IrBlock *s0, IrBlock *s1);
+
+/* Procedure irInsertBefore inserts i before the
+ * instruction pos of block b
+ */
+void irInsertBefore(IrBlock *b, IrInstr *pos, IrInstr *i);
+
+/* Procedure irRemove unlinks i from block b */
+void irRemove(IrBlock *b, IrInstr *i);
+
+/* Function irIsTerminator returns TRUE for the
+ * operations that end a block
+ */
+int irIsTerminator(IrOp op);
+
+/* Function irHasSideEffects returns TRUE if the
+ * instruction must be kept even when its result
+ * is unused
+ */
+int irHasSideEffects(IrInstr *i);
+
+/* Function irUses stores the temporaries read by
+ * instruction i in uses (which must have room for
+ * 2 + i->nargs entries) and returns their number
+ */
+int irUses(IrInstr *i, int *uses);
+
+/* Function irDef returns the temporary written by
+ * instruction i or -1
+ */
+int irDef(IrInstr *i);
+
+/* Procedure irBuildCFG recomputes the predecessor
+ * lists of f from the successors, drops the blocks
+ * that cannot be reached from the entry and
+ * renumbers the rest in code order; the arguments
+ * of phis follow their predecessors
+ */
+void irBuildCFG(IrFunc *f);
+
+/* Procedure irSimplifyCFG removes the blocks that
+ * only jump and merges straight-line chains of
+ * blocks; f must not contain phis
+ */
+void irSimplifyCFG(IrFunc *f);
+
+/* Function irCountInstrs returns the number of IR
+ * instructions in the program
+ */
+int irCountInstrs(IrProgram *p);
+int irCountFuncInstrs(IrFunc *f);
+
+/* Function irInvertCmp returns the comparison
+ * true exactly when cmp is false
+ */
+IrOp irInvertCmp(IrOp cmp);
+
+/* Function irFoldOp evaluates the arithmetic or
+ * comparison op on constants a and b into
+ * *result; it returns FALSE when the operation
+ * must be left to run time
+ */
+int irFoldOp(IrOp op, int a, int b, int *result);
+
+/* Procedure irPrintProgram writes a textual dump
+ * of the program to the file out
+ */
+void irPrintProgram(FILE *out, IrProgram *p);
+void irPrintFunc(FILE *out, IrFunc *f);
+
+/* Procedure irPrintInstr writes instruction i of
+ * block b on a line of its own; p may be NULL
+ */
+void irPrintInstr(FILE *out, IrProgram *p, IrBlock *b, IrInstr *i);
+
+#endif
@@ -0,0 +1,526 @@
+/****************************************************/
+/* File: isel.c                                     */
+/* Instruction selection from the IR to TM code     */
+/* for the C-- compiler                             */
+/****************************************************/
+
+#include <pthread.h>
+#include <unistd.h>
+
+#include "globals.h"
+#include "code.h"
+#include "ir.h"
+#include "frame.h"
+#include "regalloc.h"
+#include "tail.h"
+#include "isel.h"
+
+/* Every temporary lives either in the register
+ * the allocator gave it or in a frame word; with
+ * no allocation temporary t lives in -1-t(mp), so
+ * the parameters land where frame.h puts them and
+ * the frame is 1 + ntemps words. Operands not in
+ * registers are brought into ac and ac1, results
+ * not in registers are computed in ac and stored.
+ */
+
+/* a jump or call whose target was not known when
+ * it was emitted
+ */
+typedef struct
+{
+    int loc;     /* the skipped code location */
+    char *op;    /* the jump opcode */
+    int reg;     /* register tested by the jump */
+    int block;   /* target block, or -1 for a call */
+    char *callee;
+} Fixup;
+
+/* Functions are selected concurrently, each into
+ * a code buffer of its own (see emitDetach), so
+ * the state of the function being selected is
+ * per thread. The main thread then lays the
+ * functions out in program order and resolves the
+ * calls between them.
+ */
+static _Thread_local Fixup *fixups = NULL;
+static _Thread_local int nfixups = 0, maxfixups = 0;
+
+/* entry location of every function emitted */
+static IrFunc **funcs = NULL;
+static int *funcLoc = NULL;
+static int nfuncs = 0;
+
+/* the code of a function, selected on its own:
+ * the locations of its calls are relative to it
+ */
+typedef struct
+{
+    CodeBuffer *code;
+    Fixup *calls;
+    int ncalls;
+} FuncCode;
+
+static FuncCode *selected = NULL;
+
+/* the next function for a thread to select */
+static int nextFunc = 0;
+static pthread_mutex_t nextLock = PTHREAD_MUTEX_INITIALIZER;
+
+/* code location of every block of the function */
+static _Thread_local int *blockLoc = NULL;
+
+static void pushFixup(Fixup *x)
+{
+    if (nfixups == maxfixups)
+    {
+        maxfixups = maxfixups ? 2 * maxfixups : 64;
+        fixups = realloc(fixups, maxfixups * sizeof(Fixup));
+    }
+    fixups[nfixups++] = *x;
+}
+
+static void addFixup(char *op, int reg, int block, char *callee)
+{
+    Fixup x;
+    x.loc = emitSkip(1);
+    x.op = op;
+    x.reg = reg;
+    x.block = block;
+    x.callee = callee;
+    pushFixup(&x);
+}
+
+/* the function being selected */
+static _Thread_local IrFunc *fn = NULL;
+
+static int slot(int t)
+{
+    return fn->slot != NULL ? fn->slot[t] : -1 - t;
+}
+
+static int regOf(IrOperand o)
+{
+    if (o.kind == OpdTemp && fn->reg != NULL)
+        return fn->reg[o.val];
+    return -1;
+}
+
+static int currentFrame(void)
+{
+    return fn->reg != NULL ? fn->frameSize : 1 + fn->ntemps;
+}
+
+/* Function useOperand returns the register
+ * holding operand o, loading it into scratch
+ * if it is not in one
+ */
+static int useOperand(IrOperand o, int scratch)
+{
+    int r = regOf(o);
+    if (r >= 0)
+        return r;
+    if (o.kind == OpdConst)
+        emitRM("LDC", scratch, o.val, 0, "load const");
+    else if (o.kind == OpdTemp)
+        emitRM("LD", scratch, slot(o.val), mp, "load temp");
+    return scratch;
+}
+
+/* Procedure loadOperand brings operand o into
+ * register r
+ */
+static void loadOperand(int r, IrOperand o)
+{
+    int s = useOperand(o, r);
+    if (s != r)
+        emitRM("LDA", r, 0, s, "move");
+}
+
+/* Function resultReg returns the register an
+ * instruction should compute dst in
+ */
+static int resultReg(IrOperand dst)
+{
+    int r = regOf(dst);
+    return r >= 0 ? r : ac;
+}
+
+/* Procedure storeResult saves the value computed
+ * in register r to dst if dst lives in memory
+ */
+static void storeResult(IrOperand dst, int r)
+{
+    if (dst.kind == OpdTemp && regOf(dst) < 0)
+        emitRM("ST", r, slot(dst.val), mp, "store temp");
+}
+
+static char *arithOp(IrOp op)
+{
+    switch (op)
+    {
+    case IrAdd: return "ADD";
+    case IrSub: return "SUB";
+    case IrMul: return "MUL";
+    default: return "DIV";
+    }
+}
+
+static char *jumpOp(IrOp op)
+{
+    switch (op)
+    {
+    case IrLt: return "JLT";
+    case IrLe: return "JLE";
+    case IrGt: return "JGT";
+    case IrGe: return "JGE";
+    case IrEq: return "JEQ";
+    default: return "JNE";
+    }
+}
+
+/* Procedure jumpTo emits an unconditional jump to
+ * block b of the current function unless b is
+ * the block laid out next
+ */
+static void jumpTo(IrBlock *b, IrBlock *next)
+{
+    if (b != next)
+        addFixup("LDA", pc, b->id, NULL);
+}
+
+/* Procedure selectCall stores the arguments in
+ * the callee frame and saves the registers live
+ * across the call in the save area of the frame
+ */
+/* Procedure selectTailCall makes the call i,
+ * followed by a return of its result, reuse the
+ * current frame: the arguments overwrite the
+ * parameters and the callee gets the return
+ * address of this function, so it returns
+ * straight to our caller. Arguments that may be
+ * read from the frame are staged below it first
+ */
+static void selectTailCall(IrInstr *i)
+{
+    int frame = currentFrame();
+    int k, direct = TRUE;
+    for (k = 0; k < i->nargs; k++)
+        if (i->args[k].kind == OpdTemp && regOf(i->args[k]) < 0)
+            direct = FALSE;
+    for (k = 0; k < i->nargs; k++)
+        emitRM("ST", useOperand(i->args[k], ac), direct ? -1 - k : -frame - 1 - k, mp,
+               "store arg");
+    if (!direct)
+        for (k = 0; k < i->nargs; k++)
+        {
+            emitRM("LD", ac, -frame - 1 - k, mp, "move arg");
+            emitRM("ST", ac, -1 - k, mp, "over parameter");
+        }
+    emitRM("LD", ac1, RETADDR_OFFSET, mp, "pass on return address");
+    addFixup("LDA", pc, -1, i->callee);
+}
+
+static void selectCall(IrInstr *i)
+{
+    int frame = currentFrame();
+    int k, r;
+    for (k = 0; k < i->nargs; k++)
+        emitRM("ST", useOperand(i->args[k], ac), -frame - 1 - k, mp, "store arg");
+    for (r = FIRST_REG; r <= LAST_REG; r++)
+        if (i->saved & (1 << r))
+            emitRM("ST", r, fn->saveBase - (r - FIRST_REG), mp, "save register");
+    emitRM("LDA", mp, -frame, mp, "push frame");
+    emitRM("LDA", ac1, 1, pc, "save return address");
+    addFixup("LDA", pc, -1, i->callee);
+    emitRM("LDA", mp, frame, mp, "pop frame");
+    for (r = FIRST_REG; r <= LAST_REG; r++)
+        if (i->saved & (1 << r))
+            emitRM("LD", r, fn->saveBase - (r - FIRST_REG), mp, "restore register");
+    if (i->dst.kind == OpdTemp)
+    {
+        if (regOf(i->dst) >= 0)
+            emitRM("LDA", regOf(i->dst), 0, ac, "move result");
+        else
+            storeResult(i->dst, ac);
+    }
+}
+
+/* Procedure selectBranch compares with a single
+ * SUB (none against 0) and jumps on the condition;
+ * when the true block comes next the condition is
+ * inverted and the jump goes to the false block
+ */
+static void selectBranch(IrBlock *b, IrBlock *next, IrInstr *i)
+{
+    IrOp cmp = i->cmp;
+    IrBlock *yes = b->succ[0], *no = b->succ[1];
+    int r;
+    if (i->b.kind == OpdConst && i->b.val == 0)
+        r = useOperand(i->a, ac);
+    else
+    {
+        int ra = useOperand(i->a, ac);
+        int rb = useOperand(i->b, ac1);
+        emitRO("SUB", ac, ra, rb, "compare");
+        r = ac;
+    }
+    if (yes == next)
+    {
+        cmp = irInvertCmp(cmp);
+        yes = no;
+        no = next;
+    }
+    addFixup(jumpOp(cmp), r, yes->id, NULL);
+    jumpTo(no, next);
+}
+
+static void selectInstr(IrBlock *b, IrBlock *next, IrInstr *i)
+{
+    int ra, rb, rd;
+    switch (i->op)
+    {
+    case IrNop:
+    case IrPhi:
+        break;
+    case IrMov:
+        rd = resultReg(i->dst);
+        if (regOf(i->dst) >= 0)
+            loadOperand(rd, i->a);
+        else
+            storeResult(i->dst, useOperand(i->a, ac));
+        break;
+    case IrAdd:
+    case IrSub:
+    case IrMul:
+    case IrDiv:
+        ra = useOperand(i->a, ac);
+        rb = useOperand(i->b, ac1);
+        rd = resultReg(i->dst);
+        emitRO(arithOp(i->op), rd, ra, rb, "op");
+        storeResult(i->dst, rd);
+        break;
+    case IrLt:
+    case IrLe:
+    case IrGt:
+    case IrGe:
+    case IrEq:
+    case IrNe:
+        ra = useOperand(i->a, ac);
+        rb = useOperand(i->b, ac1);
+        rd = resultReg(i->dst);
+        emitRO("SUB", ac, ra, rb, "compare");
+        emitRM(jumpOp(i->op), ac, 2, pc, "br if true");
+        emitRM("LDC", rd, 0, 0, "false case");
+        emitRM("LDA", pc, 1, pc, "unconditional jmp");
+        emitRM("LDC", rd, 1, 0, "true case");
+        storeResult(i->dst, rd);
+        break;
+    case IrLoad:
+        rd = resultReg(i->dst);
+        emitRM("LD", rd, i->sym, gp, "load global");
+        storeResult(i->dst, rd);
+        break;
+    case IrStore:
+        emitRM("ST", useOperand(i->a, ac), i->sym, gp, "store global");
+        break;
+    case IrIn:
+        rd = resultReg(i->dst);
+        emitRO("IN", rd, 0, 0, "read integer value");
+        storeResult(i->dst, rd);
+        break;
+    case IrOut:
+        emitRO("OUT", useOperand(i->a, ac), 0, 0, "write value");
+        break;
+    case IrCall:
+        if (isTailCall(i) && i->saved == 0)
+            selectTailCall(i);
+        else
+            selectCall(i);
+        break;
+    case IrJump:
+        jumpTo(b->succ[0], next);
+        break;
+    case IrBranch:
+        selectBranch(b, next, i);
+        break;
+    case IrReturn:
+        if (i->prev != NULL && isTailCall(i->prev) && i->prev->saved == 0)
+            break; /* the callee returns for us */
+        if (i->a.kind != OpdNone)
+            loadOperand(ac, i->a);
+        emitRM("LD", pc, RETADDR_OFFSET, mp, "return to caller");
+        break;
+    }
+}
+
+static int lookupFunc(char *name)
+{
+    int k;
+    for (k = 0; k < nfuncs; k++)
+        if (strcmp(funcs[k]->name, name) == 0)
+            return k;
+    return -1;
+}
+
+/* Procedure selectFunc emits function funcs[n]
+ * into the buffer of the calling thread, resolves
+ * its jumps between blocks and leaves the code and
+ * the calls in selected[n]
+ */
+static void selectFunc(int n)
+{
+    IrFunc *f = funcs[n];
+    FuncCode *c = &selected[n];
+    int k, first = nfixups;
+    char buf[120];
+    blockLoc = realloc(blockLoc, (f->nblocks + 1) * sizeof(int));
+    sprintf(buf, "-> function %s", f->name);
+    emitComment(buf);
+    emitSymbol(f->name);
+    fn = f;
+    emitRM("ST", ac1, RETADDR_OFFSET, mp, "save return address");
+    for (k = 0; k < f->nparams; k++)
+        if (regOf(irTemp(k)) >= 0)
+            emitRM("LD", regOf(irTemp(k)), slot(k), mp, "load parameter");
+    for (k = 0; k < f->nblocks; k++)
+    {
+        IrBlock *b = f->blocks[k];
+        IrBlock *next = k + 1 < f->nblocks ? f->blocks[k + 1] : NULL;
+        IrInstr *i;
+        blockLoc[k] = emitSkip(0);
+        for (i = b->first; i != NULL; i = i->next)
+            selectInstr(b, next, i);
+    }
+    for (k = first; k < nfixups; k++)
+        if (fixups[k].block >= 0)
+        {
+            emitBackup(fixups[k].loc);
+            emitRM_Abs(fixups[k].op, fixups[k].reg, blockLoc[fixups[k].block],
+                       "jump to block");
+        }
+    emitRestore();
+    sprintf(buf, "<- function %s", f->name);
+    emitComment(buf);
+    c->calls = (Fixup *)malloc((nfixups - first + 1) * sizeof(Fixup));
+    c->ncalls = 0;
+    for (k = first; k < nfixups; k++)
+        if (fixups[k].block < 0)
+            c->calls[c->ncalls++] = fixups[k];
+    nfixups = first;
+    c->code = emitDetach();
+}
+
+/* Function selectWorker selects functions until
+ * none is left
+ */
+static void *selectWorker(void *arg)
+{
+    int n;
+    (void)arg;
+    for (;;)
+    {
+        pthread_mutex_lock(&nextLock);
+        n = nextFunc++;
+        pthread_mutex_unlock(&nextLock);
+        if (n >= nfuncs)
+            return NULL;
+        selectFunc(n);
+    }
+}
+
+/* Procedure selectAll selects every function,
+ * with up to jobs threads counting this one
+ */
+static void selectAll(int jobs)
+{
+    pthread_t *threads;
+    int k, n = 0;
+    if (jobs <= 0)
+        jobs = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (jobs > nfuncs)
+        jobs = nfuncs;
+    threads = (pthread_t *)malloc((jobs + 1) * sizeof(pthread_t));
+    nextFunc = 0;
+    for (k = 1; k < jobs; k++)
+        if (pthread_create(&threads[n], NULL, selectWorker, NULL) == 0)
+            n++;
+    selectWorker(NULL);
+    for (k = 0; k < n; k++)
+        pthread_join(threads[k], NULL);
+    free(threads);
+}
+
+void selectProgram(IrProgram *p, char *codefile, int jobs)
+{
+    char *s = malloc(strlen(codefile) + 7);
+    IrFunc *f;
+    int k, j, mainCall = -1;
+    strcpy(s, "File: ");
+    strcat(s, codefile);
+    nfuncs = 0;
+    for (f = p->funcs; f != NULL; f = f->next)
+        nfuncs++;
+    funcs = realloc(funcs, (nfuncs + 1) * sizeof(IrFunc *));
+    funcLoc = realloc(funcLoc, (nfuncs + 1) * sizeof(int));
+    selected = realloc(selected, (nfuncs + 1) * sizeof(FuncCode));
+    for (f = p->funcs, k = 0; f != NULL; f = f->next)
+        funcs[k++] = f;
+    nfixups = 0;
+    selectAll(jobs);
+    emitComment("C-- Compilation to TM Code");
+    emitComment(s);
+    /* generate standard prelude (tmlink adds it to objects) */
+    if (!Relocatable)
+    {
+        emitComment("Standard prelude:");
+        emitRM("LD", mp, 0, ac, "load maxaddress from location 0");
+        emitRM("ST", ac, 0, ac, "clear location 0");
+        emitRM("LDA", ac1, 1, pc, "save return address");
+        mainCall = nfixups;
+        addFixup("LDA", pc, -1, "main");
+        emitRO("HALT", 0, 0, 0, "");
+        emitComment("End of standard prelude.");
+    }
+    /* lay the functions out in order */
+    for (k = 0; k < nfuncs; k++)
+    {
+        FuncCode *c = &selected[k];
+        funcLoc[k] = emitAppend(c->code);
+        for (j = 0; j < c->ncalls; j++)
+        {
+            c->calls[j].loc += funcLoc[k];
+            pushFixup(&c->calls[j]);
+        }
+        free(c->calls);
+    }
+    /* resolve the calls */
+    for (k = 0; k < nfixups; k++)
+    {
+        int callee;
+        if (fixups[k].block >= 0)
+            continue;
+        callee = lookupFunc(fixups[k].callee);
+        if (callee < 0 && Relocatable)
+        {
+            emitBackup(fixups[k].loc);
+            emitExtern(fixups[k].op, fixups[k].reg, fixups[k].callee, "call");
+            continue;
+        }
+        if (callee < 0)
+        {
+            fprintf(listing, "Code generation error: %s %s\n",
+                    k == mainCall ? "no function" : "undefined function",
+                    fixups[k].callee);
+            Error = TRUE;
+            continue;
+        }
+        emitBackup(fixups[k].loc);
+        emitRM_Abs(fixups[k].op, fixups[k].reg, funcLoc[callee], "call");
+    }
+    emitRestore();
+    emitComment("End of execution.");
+    if (!Error) /* a program with errors gets no code */
+        emitFlush();
+    free(s);
+}
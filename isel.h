@@ -0,0 +1,23 @@
+/****************************************************/
+/* File: isel.h                                     */
+/* Instruction selection from the IR to TM code     */
+/* for the C-- compiler                             */
+/****************************************************/
+
+#ifndef _ISEL_H_
+#define _ISEL_H_
+
+#include "ir.h"
+
+/* Procedure selectProgram emits the TM code of the
+ * IR program p to the code file. The second
+ * parameter (codefile) is the file name of the
+ * code file, and is used to print the file name
+ * as a comment in the code file. The functions
+ * are selected by up to jobs threads (0 for one
+ * per processor); the code does not depend on
+ * the number
+ */
+void selectProgram(IrProgram *p, char *codefile, int jobs);
+
+#endif
@@ -0,0 +1,429 @@
+/****************************************************/
+/* File: loop.c                                     */
+/* Natural loops and loop-invariant code motion on  */
+/* the IR for the C-- compiler                      */
+/****************************************************/
+
+#include "globals.h"
+#include "ir.h"
+#include "ssa.h"
+#include "pure.h"
+#include "loop.h"
+
+/* a natural loop: the header and the blocks that
+ * reach one of its back edges without going
+ * through the header; loops sharing a header are
+ * merged
+ */
+typedef struct
+{
+    IrBlock *header;
+    char *body; /* body[k] is TRUE if blocks[k] is in the loop */
+    int size;
+} Loop;
+
+static Loop *loops = NULL;
+static int nloops = 0, maxloops = 0;
+
+static IrBlock **stack = NULL;
+
+/* Procedure addBody adds to loop l the block b at
+ * the tail of a back edge and every block reaching
+ * it inside the loop
+ */
+static void addBody(Loop *l, IrBlock *b)
+{
+    int sp = 0, j;
+    if (!l->body[b->id])
+    {
+        l->body[b->id] = TRUE;
+        l->size++;
+        stack[sp++] = b;
+    }
+    while (sp > 0)
+    {
+        IrBlock *x = stack[--sp];
+        for (j = 0; j < x->npred; j++)
+        {
+            IrBlock *p = x->pred[j];
+            if (!l->body[p->id])
+            {
+                l->body[p->id] = TRUE;
+                l->size++;
+                stack[sp++] = p;
+            }
+        }
+    }
+}
+
+static Loop *loopOf(IrFunc *f, IrBlock *h)
+{
+    int k;
+    for (k = 0; k < nloops; k++)
+        if (loops[k].header == h)
+            return &loops[k];
+    if (nloops == maxloops)
+    {
+        maxloops = maxloops ? 2 * maxloops : 8;
+        loops = realloc(loops, maxloops * sizeof(Loop));
+    }
+    loops[nloops].header = h;
+    loops[nloops].body = (char *)calloc(f->nblocks + 1, 1);
+    loops[nloops].body[h->id] = TRUE;
+    loops[nloops].size = 1;
+    return &loops[nloops++];
+}
+
+/* Procedure findLoops collects the natural loops
+ * of f from the edges going to a dominator
+ */
+static void findLoops(IrFunc *f)
+{
+    int k, j;
+    for (k = 0; k < nloops; k++)
+        free(loops[k].body);
+    nloops = 0;
+    computeDominators(f);
+    stack = realloc(stack, (f->nblocks + 1) * sizeof(IrBlock *));
+    for (k = 0; k < f->nblocks; k++)
+    {
+        IrBlock *b = f->blocks[k];
+        for (j = 0; j < b->nsucc; j++)
+            if (dominates(b->succ[j], b))
+                addBody(loopOf(f, b->succ[j]), b);
+    }
+}
+
+/* Function preheader returns the only block
+ * outside loop l that enters its header, or NULL
+ */
+static IrBlock *preheader(Loop *l)
+{
+    IrBlock *h = l->header, *p = NULL;
+    int j;
+    for (j = 0; j < h->npred; j++)
+        if (!l->body[h->pred[j]->id])
+        {
+            if (p != NULL)
+                return NULL;
+            p = h->pred[j];
+        }
+    return p;
+}
+
+/* Function splitEntries gives every loop whose
+ * header is entered from a block that also
+ * branches elsewhere a block of its own on that
+ * edge, placed just before the header; it
+ * returns TRUE if it created any
+ */
+static int splitEntries(IrFunc *f)
+{
+    int k, j, split = FALSE;
+    for (k = 0; k < nloops; k++)
+    {
+        IrBlock *h = loops[k].header;
+        IrBlock *p = preheader(&loops[k]);
+        IrBlock *m;
+        if (p == NULL || p->nsucc == 1)
+            continue;
+        m = irNewBlockAt(f, h->id);
+        irAppend(m, irNewInstr(IrJump, irNone(), irNone(), irNone()));
+        irSetSuccs(m, h, NULL);
+        for (j = 0; j < p->nsucc; j++)
+            if (p->succ[j] == h)
+                p->succ[j] = m;
+        for (j = 0; j < h->npred; j++)
+            if (h->pred[j] == p)
+                h->pred[j] = m;
+        m->pred = (IrBlock **)malloc(sizeof(IrBlock *));
+        m->pred[0] = p;
+        m->npred = m->maxpred = 1;
+        split = TRUE;
+    }
+    return split;
+}
+
+static int bySize(const void *x, const void *y)
+{
+    return ((const Loop *)x)->size - ((const Loop *)y)->size;
+}
+
+static int *defBlock = NULL;      /* block defining each temporary, -1 for the parameters */
+static IrInstr **defInstr = NULL; /* instruction defining each temporary */
+static int ndefs = 0;
+
+/* Function prepareLoops finds the loops of f,
+ * innermost first, gives them preheaders where
+ * needed and records where every temporary is
+ * defined; it returns the number of loops
+ */
+static int prepareLoops(IrFunc *f)
+{
+    int k;
+    findLoops(f);
+    if (nloops == 0)
+        return 0;
+    if (splitEntries(f))
+        findLoops(f);
+    qsort(loops, nloops, sizeof(Loop), bySize);
+    ndefs = f->ntemps;
+    defBlock = realloc(defBlock, (ndefs + 1) * sizeof(int));
+    defInstr = realloc(defInstr, (ndefs + 1) * sizeof(IrInstr *));
+    for (k = 0; k < ndefs; k++)
+    {
+        defBlock[k] = -1;
+        defInstr[k] = NULL;
+    }
+    for (k = 0; k < f->nblocks; k++)
+    {
+        IrInstr *i;
+        for (i = f->blocks[k]->first; i != NULL; i = i->next)
+            if (irDef(i) >= 0)
+            {
+                defBlock[irDef(i)] = k;
+                defInstr[irDef(i)] = i;
+            }
+    }
+    return nloops;
+}
+
+static int invariant(Loop *l, IrOperand o)
+{
+    return o.kind != OpdTemp || defBlock[o.val] < 0 || !l->body[defBlock[o.val]];
+}
+
+/* Function hoistLoop moves the invariant
+ * instructions of loop l to the end of its
+ * preheader pre, visiting the blocks in reverse
+ * postorder so that an instruction follows the
+ * invariants it reads
+ */
+static int hoistLoop(IrProgram *p, IrFunc *f, Loop *l, IrBlock *pre, IrBlock **byRpo)
+{
+    char *stored = (char *)calloc(p->nglobals + 1, 1);
+    int allStored = FALSE, moved = 0, k;
+    IrInstr *i, *next;
+    for (k = 0; k < f->nblocks; k++)
+    {
+        if (!l->body[k])
+            continue;
+        for (i = f->blocks[k]->first; i != NULL; i = i->next)
+            if (i->op == IrStore && i->sym < p->nglobals)
+                stored[i->sym] = TRUE;
+            else if (i->op == IrStore || (i->op == IrCall && !isPureFunction(i->callee)))
+                allStored = TRUE;
+    }
+    for (k = 0; k < f->nblocks; k++)
+    {
+        IrBlock *b = byRpo[k];
+        int first = b == l->header; /* nothing has run yet in the loop */
+        if (b == NULL || !l->body[b->id])
+            continue;
+        for (i = b->first; i != NULL; i = next)
+        {
+            int ok;
+            next = i->next;
+            switch (i->op)
+            {
+            case IrMov:
+            case IrAdd:
+            case IrSub:
+            case IrMul:
+            case IrLt:
+            case IrLe:
+            case IrGt:
+            case IrGe:
+            case IrEq:
+            case IrNe:
+                ok = TRUE;
+                break;
+            case IrDiv:
+                ok = first || !irHasSideEffects(i);
+                break;
+            case IrLoad:
+                ok = !allStored && !stored[i->sym];
+                break;
+            default:
+                ok = FALSE;
+                break;
+            }
+            if (ok && invariant(l, i->a) && invariant(l, i->b))
+            {
+                irRemove(b, i);
+                irInsertBefore(pre, pre->last, i);
+                defBlock[i->dst.val] = pre->id;
+                if (TraceOpt)
+                {
+                    if (moved == 0)
+                        fprintf(listing, "%s: loop at line %d, hoisted\n",
+                                f->name, l->header->last->lineno);
+                    irPrintInstr(listing, p, pre, i);
+                }
+                moved++;
+            }
+            else if (i->op != IrPhi && irHasSideEffects(i))
+                first = FALSE;
+        }
+    }
+    free(stored);
+    return moved;
+}
+
+int hoistInvariants(IrProgram *p, IrFunc *f)
+{
+    IrBlock **byRpo;
+    int k, moved = 0;
+    if (prepareLoops(f) == 0)
+        return 0;
+    byRpo = (IrBlock **)calloc(f->nblocks + 1, sizeof(IrBlock *));
+    for (k = 0; k < f->nblocks; k++)
+    {
+        IrBlock *b = f->blocks[k];
+        if (b == f->blocks[0] || b->idom != NULL)
+            byRpo[b->rpo] = b;
+    }
+    for (k = 0; k < nloops; k++)
+    {
+        IrBlock *pre = preheader(&loops[k]);
+        if (pre != NULL && pre->nsucc == 1)
+            moved += hoistLoop(p, f, &loops[k], pre, byRpo);
+    }
+    free(byRpo);
+    return moved;
+}
+
+/* Function stepOf returns TRUE if temporary t is
+ * a basic induction variable of loop l: a phi of
+ * the header, entered with init from the
+ * preheader, that the loop moves on by the
+ * constant *step in the instruction *update
+ */
+static int stepOf(Loop *l, int t, int in, int back, IrOperand *init,
+                  int *step, IrInstr **update)
+{
+    IrInstr *phi, *u;
+    IrOperand next;
+    if (t >= ndefs || (phi = defInstr[t]) == NULL || phi->op != IrPhi ||
+        defBlock[t] != l->header->id)
+        return FALSE;
+    next = phi->args[back];
+    if (next.kind != OpdTemp || next.val >= ndefs || (u = defInstr[next.val]) == NULL)
+        return FALSE;
+    if (u->op == IrAdd && u->a.kind == OpdTemp && u->a.val == t && u->b.kind == OpdConst)
+        *step = u->b.val;
+    else if (u->op == IrAdd && u->b.kind == OpdTemp && u->b.val == t && u->a.kind == OpdConst)
+        *step = u->a.val;
+    else if (u->op == IrSub && u->a.kind == OpdTemp && u->a.val == t && u->b.kind == OpdConst)
+        *step = -u->b.val;
+    else
+        return FALSE;
+    *init = phi->args[in];
+    *update = u;
+    return TRUE;
+}
+
+/* Function reduceLoop gives every product of a
+ * basic induction variable i of loop l by a
+ * constant c an induction variable of its own,
+ * started at init*c in the preheader and moved on
+ * by step*c next to the update of i, so the loop
+ * adds instead of multiplying
+ */
+static int reduceLoop(IrProgram *p, IrFunc *f, Loop *l, IrBlock *pre)
+{
+    IrBlock *h = l->header;
+    int in, back, k, n = 0;
+    if (h->npred != 2)
+        return 0;
+    back = l->body[h->pred[0]->id] ? 0 : 1;
+    in = 1 - back;
+    if (l->body[h->pred[in]->id] || !l->body[h->pred[back]->id])
+        return 0;
+    for (k = 0; k < f->nblocks; k++)
+    {
+        IrInstr *i;
+        if (!l->body[k])
+            continue;
+        for (i = f->blocks[k]->first; i != NULL; i = i->next)
+        {
+            IrOperand iv, init, start;
+            IrInstr *update, *phi, *j;
+            int c, step, t;
+            if (i->op != IrMul)
+                continue;
+            if (i->a.kind == OpdTemp && i->b.kind == OpdConst)
+                iv = i->a, c = i->b.val;
+            else if (i->b.kind == OpdTemp && i->a.kind == OpdConst)
+                iv = i->b, c = i->a.val;
+            else
+                continue;
+            if (!stepOf(l, iv.val, in, back, &init, &step, &update))
+                continue;
+            if (TraceOpt)
+            {
+                if (n == 0)
+                    fprintf(listing, "%s: loop at line %d, reduced\n",
+                            f->name, h->last->lineno);
+                irPrintInstr(listing, p, f->blocks[k], i);
+            }
+            if (init.kind == OpdConst)
+                start = irConst(init.val * c);
+            else
+            {
+                start = irTemp(irNewTemp(f));
+                j = irNewInstr(IrMul, start, init, irConst(c));
+                j->lineno = i->lineno;
+                irInsertBefore(pre, pre->last, j);
+            }
+            t = irNewTemp(f);
+            phi = irNewInstr(IrPhi, irTemp(t), irNone(), irNone());
+            phi->nargs = 2;
+            phi->args = (IrOperand *)malloc(2 * sizeof(IrOperand));
+            phi->args[in] = start;
+            phi->args[back] = irTemp(irNewTemp(f));
+            phi->lineno = i->lineno;
+            irInsertBefore(h, h->first, phi);
+            j = irNewInstr(IrAdd, phi->args[back], irTemp(t), irConst(step * c));
+            j->lineno = i->lineno;
+            irInsertBefore(f->blocks[defBlock[update->dst.val]], update->next, j);
+            i->op = IrMov;
+            i->a = irTemp(t);
+            i->b = irNone();
+            n++;
+        }
+    }
+    return n;
+}
+
+int reduceStrength(IrProgram *p, IrFunc *f)
+{
+    int k, n = 0;
+    /* x * 2 is one add instead of a constant load and a multiply */
+    for (k = 0; k < f->nblocks; k++)
+    {
+        IrInstr *i;
+        for (i = f->blocks[k]->first; i != NULL; i = i->next)
+            if (i->op == IrMul && i->b.kind == OpdConst && i->b.val == 2)
+            {
+                i->op = IrAdd;
+                i->b = i->a;
+                n++;
+            }
+            else if (i->op == IrMul && i->a.kind == OpdConst && i->a.val == 2)
+            {
+                i->op = IrAdd;
+                i->a = i->b;
+                n++;
+            }
+    }
+    if (prepareLoops(f) == 0)
+        return n;
+    for (k = 0; k < nloops; k++)
+    {
+        IrBlock *pre = preheader(&loops[k]);
+        if (pre != NULL && pre->nsucc == 1)
+            n += reduceLoop(p, f, &loops[k], pre);
+    }
+    return n;
+}
@@ -0,0 +1,31 @@
+/****************************************************/
+/* File: loop.h                                     */
+/* Natural loops and loop-invariant code motion on  */
+/* the IR for the C-- compiler                      */
+/****************************************************/
+
+#ifndef _LOOP_H_
+#define _LOOP_H_
+
+#include "ir.h"
+
+/* Function hoistInvariants finds the natural
+ * loops of f (in SSA form) and moves the
+ * computations whose operands do not change in a
+ * loop to its preheader, innermost loops first; a
+ * division that may trap is only moved when it
+ * would have run first thing on entering the loop.
+ * It returns the number of instructions moved
+ */
+int hoistInvariants(IrProgram *p, IrFunc *f);
+
+/* Function reduceStrength rewrites x*2 as x+x and
+ * replaces the products of a loop's induction
+ * variables by constants with induction variables
+ * of their own, updated by an add each time round
+ * the loop (f in SSA form); it returns the number
+ * of multiplications removed
+ */
+int reduceStrength(IrProgram *p, IrFunc *f);
+
+#endif
@@ -0,0 +1,353 @@
+/****************************************************/
+/* File: lower.c                                    */
+/* Translation of the syntax tree to the IR         */
+/* for the C-- compiler                             */
+/****************************************************/
+
+#include "globals.h"
+#include "util.h"
+#include "ir.h"
+#include "lower.h"
+
+/* the function being lowered and its current block */
+static IrFunc *fn = NULL;
+static IrBlock *cur = NULL;
+
+/* temporaries of the parameters and locals in scope */
+static TreeNode **varDecl = NULL;
+static int *varTemp = NULL;
+static int nvars = 0, maxvars = 0;
+
+static void lowerError(TreeNode *t, char *message)
+{
+    fprintf(listing, "Code generation error at line %d: %s\n", t->lineno, message);
+    Error = TRUE;
+}
+
+static int bindVar(TreeNode *decl)
+{
+    if (nvars == maxvars)
+    {
+        maxvars = maxvars ? 2 * maxvars : 16;
+        varDecl = realloc(varDecl, maxvars * sizeof(TreeNode *));
+        varTemp = realloc(varTemp, maxvars * sizeof(int));
+    }
+    varDecl[nvars] = decl;
+    varTemp[nvars] = irNewTemp(fn);
+    return varTemp[nvars++];
+}
+
+/* Function varTempOf returns the temporary of the
+ * local or parameter decl, or -1 for a global
+ */
+static int varTempOf(TreeNode *decl)
+{
+    int i;
+    for (i = nvars - 1; i >= 0; i--)
+        if (varDecl[i] == decl)
+            return varTemp[i];
+    return -1;
+}
+
+static IrInstr *emit(IrOp op, IrOperand dst, IrOperand a, IrOperand b, int lineno)
+{
+    IrInstr *i = irNewInstr(op, dst, a, b);
+    i->lineno = lineno;
+    irAppend(cur, i);
+    return i;
+}
+
+/* Procedure endBlock ends the current block with
+ * the terminator op and continues in next
+ */
+static void endBlock(IrOp op, IrOperand a, IrBlock *s0, IrBlock *s1,
+                     IrBlock *next, int lineno)
+{
+    emit(op, irNone(), a, irNone(), lineno);
+    irSetSuccs(cur, s0, s1);
+    cur = next;
+}
+
+static IrOp irOpOf(TokenType op)
+{
+    switch (op)
+    {
+    case PLUS: return IrAdd;
+    case MINUS: return IrSub;
+    case TIMES: return IrMul;
+    case OVER: return IrDiv;
+    case LT: return IrLt;
+    case LE: return IrLe;
+    case RT: return IrGt;
+    case RE: return IrGe;
+    case EQ: return IrEq;
+    default: return IrNe;
+    }
+}
+
+static IrOperand lowerExp(TreeNode *t);
+
+/* Function lowerCall emits the call t; dst
+ * receives the result unless the value is unused
+ */
+static void lowerCall(TreeNode *t, int wantValue)
+{
+    IrOperand args[64];
+    IrOperand dst = irNone();
+    IrInstr *i;
+    TreeNode *a;
+    int n = 0;
+    for (a = t->child[0]; a != NULL; a = a->sibling)
+    {
+        IrOperand v = lowerExp(a);
+        if (n < 64)
+            args[n++] = v;
+    }
+    if (n == 64)
+        lowerError(t, "too many arguments");
+    if (strcmp(t->attr.name, "input") == 0 && t->decl == NULL)
+    {
+        emit(IrIn, irTemp(irNewTemp(fn)), irNone(), irNone(), t->lineno);
+        return;
+    }
+    if (strcmp(t->attr.name, "output") == 0 && t->decl == NULL)
+    {
+        emit(IrOut, irNone(), args[0], irNone(), t->lineno);
+        return;
+    }
+    if (wantValue)
+        dst = irTemp(irNewTemp(fn));
+    i = emit(IrCall, dst, irNone(), irNone(), t->lineno);
+    i->callee = t->attr.name;
+    i->nargs = n;
+    if (n > 0)
+    {
+        i->args = (IrOperand *)malloc(n * sizeof(IrOperand));
+        memcpy(i->args, args, n * sizeof(IrOperand));
+    }
+}
+
+/* Function lowerExp emits the code of expression
+ * t and returns the operand holding its value
+ */
+static IrOperand lowerExp(TreeNode *t)
+{
+    IrOperand a, b;
+    int tmp;
+    switch (t->kind.exp)
+    {
+    case ConstK:
+        return irConst(t->attr.val);
+    case IdK:
+        tmp = varTempOf(t->decl);
+        if (tmp >= 0)
+            return irTemp(tmp);
+        if (t->decl == NULL)
+        {
+            lowerError(t, "imported variable cannot be addressed");
+            return irConst(0);
+        }
+        tmp = irNewTemp(fn);
+        emit(IrLoad, irTemp(tmp), irNone(), irNone(), t->lineno)->sym = t->decl->memloc;
+        return irTemp(tmp);
+    case OpK:
+        /* the heavier operand goes first so fewer
+         * values are live while it is computed
+         */
+        if (heavierRight(t))
+        {
+            b = lowerExp(t->child[1]);
+            a = lowerExp(t->child[0]);
+        }
+        else
+        {
+            a = lowerExp(t->child[0]);
+            b = lowerExp(t->child[1]);
+        }
+        tmp = irNewTemp(fn);
+        emit(irOpOf(t->attr.op), irTemp(tmp), a, b, t->lineno);
+        return irTemp(tmp);
+    case CallK:
+        lowerCall(t, TRUE);
+        return cur->last->dst;
+    default:
+        lowerError(t, "unexpected expression");
+        return irConst(0);
+    }
+}
+
+/* Procedure lowerCond ends the current block with
+ * a branch to s0 if the condition t holds and to
+ * s1 otherwise, continuing in next; a comparison
+ * is branched on directly instead of being
+ * turned into 0 or 1 first
+ */
+static void lowerCond(TreeNode *t, IrBlock *s0, IrBlock *s1, IrBlock *next)
+{
+    IrInstr *i;
+    IrOperand a, b;
+    IrOp cmp = IrNe;
+    if (t->kind.exp == OpK && t->type == Boolean)
+    {
+        if (heavierRight(t))
+        {
+            b = lowerExp(t->child[1]);
+            a = lowerExp(t->child[0]);
+        }
+        else
+        {
+            a = lowerExp(t->child[0]);
+            b = lowerExp(t->child[1]);
+        }
+        cmp = irOpOf(t->attr.op);
+    }
+    else
+    {
+        a = lowerExp(t);
+        b = irConst(0);
+    }
+    i = emit(IrBranch, irNone(), a, b, t->lineno);
+    i->cmp = cmp;
+    irSetSuccs(cur, s0, s1);
+    cur = next;
+}
+
+static void lowerStmt(TreeNode *t);
+
+static void lowerStmts(TreeNode *t)
+{
+    for (; t != NULL; t = t->sibling)
+        lowerStmt(t);
+}
+
+/* Procedure lowerAssign stores the value of the
+ * right-hand side of t in the variable; when the
+ * last instruction computed that value into a
+ * fresh temporary it is retargeted instead of
+ * copied
+ */
+static void lowerAssign(TreeNode *t)
+{
+    int mark = fn->ntemps;
+    IrOperand v = lowerExp(t->child[0]);
+    int var = varTempOf(t->decl);
+    if (var < 0)
+    {
+        if (t->decl == NULL)
+            lowerError(t, "imported variable cannot be addressed");
+        else
+            emit(IrStore, irNone(), v, irNone(), t->lineno)->sym = t->decl->memloc;
+        return;
+    }
+    if (v.kind == OpdTemp && v.val >= mark && cur->last != NULL &&
+        cur->last->dst.kind == OpdTemp && cur->last->dst.val == v.val)
+        cur->last->dst = irTemp(var);
+    else
+        emit(IrMov, irTemp(var), v, irNone(), t->lineno);
+}
+
+static void lowerStmt(TreeNode *t)
+{
+    IrBlock *b0, *b1, *b2;
+    IrOperand v;
+    TreeNode *d;
+    int mark;
+    if (t->nodekind == ExpK)
+    {
+        if (t->kind.exp == CallK)
+            lowerCall(t, FALSE);
+        else
+            lowerExp(t);
+        return;
+    }
+    switch (t->kind.stmt)
+    {
+    case AssignK:
+        lowerAssign(t);
+        break;
+    case CompoundK:
+        mark = nvars;
+        for (d = t->child[0]; d != NULL; d = d->sibling)
+            bindVar(d);
+        lowerStmts(t->child[1]);
+        nvars = mark;
+        break;
+    case SelectionK:
+        b0 = irNewBlock(fn);
+        b1 = t->child[2] != NULL ? irNewBlock(fn) : NULL;
+        b2 = irNewBlock(fn);
+        lowerCond(t->child[0], b0, b1 != NULL ? b1 : b2, b0);
+        lowerStmts(t->child[1]);
+        if (b1 != NULL)
+        {
+            endBlock(IrJump, irNone(), b2, NULL, b1, t->lineno);
+            lowerStmts(t->child[2]);
+        }
+        endBlock(IrJump, irNone(), b2, NULL, b2, t->lineno);
+        break;
+    case WhileK:
+        b0 = irNewBlock(fn);
+        endBlock(IrJump, irNone(), b0, NULL, b0, t->lineno);
+        b1 = irNewBlock(fn);
+        b2 = irNewBlock(fn);
+        lowerCond(t->child[0], b1, b2, b1);
+        lowerStmts(t->child[1]);
+        endBlock(IrJump, irNone(), b0, NULL, b2, t->lineno);
+        break;
+    case ReturnK:
+        v = t->child[0] != NULL ? lowerExp(t->child[0]) : irNone();
+        /* code after a return goes to a block nothing reaches */
+        endBlock(IrReturn, v, NULL, NULL, irNewBlock(fn), t->lineno);
+        break;
+    default:
+        lowerError(t, "unexpected statement");
+        break;
+    }
+}
+
+/* Function lowerFunction translates the function
+ * declaration t
+ */
+static IrFunc *lowerFunction(TreeNode *t)
+{
+    TreeNode *p;
+    int n = paramCount(t->child[0]);
+    nvars = 0;
+    fn = irNewFunc(t->attr.name, 0);
+    fn->returnsValue = t->type == Integer;
+    for (p = t->child[0]; n > 0; p = p->sibling, n--)
+        bindVar(p);
+    fn->nparams = fn->ntemps;
+    cur = irNewBlock(fn);
+    lowerStmt(t->child[1]);
+    if (cur->last == NULL || !irIsTerminator(cur->last->op))
+        endBlock(IrReturn, irNone(), NULL, NULL, NULL, t->lineno);
+    irBuildCFG(fn);
+    return fn;
+}
+
+IrProgram *lowerProgram(TreeNode *syntaxTree)
+{
+    IrProgram *p = (IrProgram *)malloc(sizeof(IrProgram));
+    IrFunc **link = &p->funcs;
+    TreeNode *t;
+    p->funcs = NULL;
+    p->nglobals = 0;
+    for (t = syntaxTree; t != NULL; t = t->sibling)
+        if (t->nodekind == StmtK && t->kind.stmt == VarDeclarationK)
+            p->nglobals++;
+    p->globalNames = (char **)malloc((p->nglobals + 1) * sizeof(char *));
+    for (t = syntaxTree; t != NULL; t = t->sibling)
+    {
+        if (t->nodekind != StmtK)
+            continue;
+        if (t->kind.stmt == VarDeclarationK)
+            p->globalNames[t->memloc] = t->attr.name;
+        else if (t->kind.stmt == FuncDeclarationK)
+        {
+            *link = lowerFunction(t);
+            link = &(*link)->next;
+        }
+    }
+    return p;
+}
@@ -0,0 +1,19 @@
+/****************************************************/
+/* File: lower.h                                    */
+/* Translation of the syntax tree to the IR         */
+/* for the C-- compiler                             */
+/****************************************************/
+
+#ifndef _LOWER_H_
+#define _LOWER_H_
+
+#include "ir.h"
+
+/* Function lowerProgram translates every function
+ * of the type-checked syntax tree into IR, one
+ * control-flow graph per function, in the order
+ * of the declarations
+ */
+IrProgram *lowerProgram(TreeNode *syntaxTree);
+
+#endif
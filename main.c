@@ -15,7 +15,16 @@
 /* set NO_CODE to TRUE to get a compiler that does not
  * generate code
  */
-#define NO_CODE TRUE
+#define NO_CODE FALSE
+
+/* set DIRECT_CODE to TRUE (or build with
+ * -DDIRECT_CODE=TRUE, see tiny_direct) to generate
+ * code straight from the syntax tree (cgen.c)
+ * instead of through the optimizing IR back end
+ */
+#ifndef DIRECT_CODE
+#define DIRECT_CODE FALSE
+#endif
 
 #include "util.h"
 
@@ -26,9 +35,23 @@
 #include "parse.h"
 
 #if !NO_ANALYZE
+#include "callgraph.h"
+#include "iface.h"
 #include "analyze.h"
+#include "unroll.h"
+#include "frame.h"
+#include "passes.h"
 #if !NO_CODE
+#include "code.h"
+#endif
+#if !NO_CODE && DIRECT_CODE
 #include "cgen.h"
+#elif !NO_CODE
+#include "lower.h"
+#include "inline.h"
+#include "regalloc.h"
+#include "isel.h"
+#include "x86gen.h"
 #endif
 #endif
 #endif
@@ -45,17 +68,80 @@ int TraceScan = TRUE;
 int TraceParse = TRUE;
 int TraceAnalyze = TRUE;
 int TraceCode = TRUE;
+int TraceOpt = TRUE;
+int TraceIR = TRUE;
 
 int Error = FALSE;
+int Relocatable = FALSE;
 
 int main(int argc, char *argv[]) {
     TreeNode *syntaxTree;
+#if !NO_ANALYZE && !NO_CODE && !DIRECT_CODE
+    IrProgram *ir;
+    int growth = INLINE_GROWTH; /* -g<percent>: growth allowed to inlining */
+    int jobs = 0; /* -j<threads>: threads of instruction selection, 0 for one per processor */
+#endif
     char pgm[120]; /* source code file name */
-    if (argc != 2) {
-        fprintf(stderr, "usage: %s <filename>\n", argv[0]);
+    char *imports[64]; /* interface files to load */
+    int nimports = 0;
+    int emitInterface = FALSE;
+#if !NO_ANALYZE && !NO_CODE
+    int binary = FALSE; /* -b: write the code file in binary */
+    int native = FALSE; /* -S: write x86-64 assembler instead of TM code */
+#endif
+#if !NO_ANALYZE
+    int unroll = UNROLL_FACTOR; /* -u<factor>: copies of an unrolled loop body */
+    int level = OPT_LEVEL; /* -O<level>: optimization level */
+    char *passList = NULL; /* -P<pass,...>: passes to run instead of a level */
+    int statistics = FALSE; /* -s: report the time and effect of every pass */
+#endif
+    int i;
+    pgm[0] = '\0';
+    for (i = 1; i < argc; i++) {
+        int len = strlen(argv[i]);
+        if (strcmp(argv[i], "-i") == 0)
+            emitInterface = TRUE;
+#if !NO_ANALYZE
+        else if (strncmp(argv[i], "-u", 2) == 0 && isdigit(argv[i][2]))
+            unroll = atoi(argv[i] + 2);
+        else if (strncmp(argv[i], "-O", 2) == 0 && isdigit(argv[i][2]))
+            level = atoi(argv[i] + 2);
+        else if (strncmp(argv[i], "-P", 2) == 0)
+            passList = argv[i] + 2;
+        else if (strcmp(argv[i], "-s") == 0)
+            statistics = TRUE;
+#endif
+#if !NO_ANALYZE && !NO_CODE
+        else if (strcmp(argv[i], "-b") == 0)
+            binary = TRUE;
+        else if (strcmp(argv[i], "-c") == 0)
+            binary = Relocatable = TRUE;
+#endif
+#if !NO_ANALYZE && !NO_CODE && !DIRECT_CODE
+        else if (strncmp(argv[i], "-g", 2) == 0 && isdigit(argv[i][2]))
+            growth = atoi(argv[i] + 2);
+        else if (strncmp(argv[i], "-j", 2) == 0 && isdigit(argv[i][2]))
+            jobs = atoi(argv[i] + 2);
+        else if (strcmp(argv[i], "-S") == 0)
+            native = TRUE;
+#endif
+        else if (len > 4 && strcmp(argv[i] + len - 4, ".cmi") == 0 && nimports < 64)
+            imports[nimports++] = argv[i];
+        else if (pgm[0] == '\0' && argv[i][0] != '-' && len < 115)
+            strcpy(pgm, argv[i]);
+        else
+            pgm[0] = '\0', i = argc;
+    }
+    if (pgm[0] == '\0') {
+        fprintf(stderr, "usage: %s [-i] [-b] [-c] [-O<level>] [-P<pass,...>] [-s] [-u<factor>] [-g<percent>] [-j<threads>] [-S] <filename> [interface.cmi ...]\n", argv[0]);
         exit(1);
     }
-    strcpy(pgm, argv[1]);
+#if !NO_ANALYZE
+    if (passList == NULL)
+        selectOptLevel(level);
+    else if (!selectPasses(passList))
+        exit(1);
+#endif
     if (strchr(pgm, '.') == NULL) // 添加后缀
         strcat(pgm, ".tny");
     source = fopen(pgm, "r");
@@ -78,6 +164,12 @@ int main(int argc, char *argv[]) {
     {
         if (TraceAnalyze)
             fprintf(listing, "\nBuilding Symbol Table...\n");
+        for (i = 0; i < nimports; i++) {
+            if (!loadInterface(imports[i])) {
+                fprintf(stderr, "Unable to load interface %s\n", imports[i]);
+                exit(1);
+            }
+        }
         buildSymtab(syntaxTree); //根据语法树得到符号表
         if (TraceAnalyze)
             fprintf(listing, "\nChecking Types...\n");
@@ -85,29 +177,92 @@ int main(int argc, char *argv[]) {
         if (TraceAnalyze)
             fprintf(listing, "\nType Checking Finished\n");
     }
+    if (!Error && emitInterface) // 接口含全部函数，须在删除不可达函数之前写出
+    {
+        char *ifacefile;
+        int fnlen = strcspn(pgm, ".");
+        ifacefile = (char *)calloc(fnlen + 5, sizeof(char));
+        strncpy(ifacefile, pgm, fnlen);
+        strcat(ifacefile, ".cmi");
+        if (!writeInterface(syntaxTree, ifacefile))
+        {
+            printf("Unable to write %s\n", ifacefile);
+            exit(1);
+        }
+    }
+    if (!Error)
+    {
+        /* unreachable functions go only after they are checked */
+        if (TraceAnalyze)
+            fprintf(listing, "\nBuilding Call Graph...\n");
+        buildCallGraph(syntaxTree); // 从 main 出发求可达函数
+        syntaxTree = pruneCallGraph(syntaxTree);
+    }
+    if (!Error)
+    {
+        if (TraceOpt)
+            fprintf(listing, "\nOptimizing Syntax Tree...\n");
+        syntaxTree = runTreePasses(syntaxTree, unroll); // 常量折叠、纯函数求值、循环展开
+        if (TraceOpt && TraceParse) {
+            fprintf(listing, "\nSyntax tree after folding:\n");
+            printTree(syntaxTree);
+        }
+        labelTree(syntaxTree); // 自底向上标注 Sethi-Ullman 数
+        buildFrames(syntaxTree); // 分配存储并估计栈深度
+    }
 #if !NO_CODE
     if (!Error)
     {
         char *codefile;
+        TreeNode *t;
         // size_t strcspn(const char *str1, const char *str2)
         // 检索 str1 开头连续有几个字符都不含 str2 中的字符
         // 此处用于求后缀前的文件名的长度
         int fnlen = strcspn(pgm, ".");
-        codefile = (char *)calloc(fnlen + 4, sizeof(char));
+        codefile = (char *)calloc(fnlen + 5, sizeof(char));
         strncpy(codefile, pgm, fnlen);
-        strcat(codefile, ".tm");
-        code = fopen(codefile, "w");
+        strcat(codefile, native ? ".s" : Relocatable ? ".tmo" : binary ? ".tmb" : ".tm");
+        code = fopen(codefile, binary && !native ? "wb" : "w");
         if (code == NULL)
         {
             printf("Unable to open %s\n", codefile);
             exit(1);
         }
-        codeGen(syntaxTree, codefile); // 生成 .tm 文件
+        if (binary)
+            emitFormat(Relocatable ? TmObject : TmBinary);
+        for (t = syntaxTree; t != NULL; t = t->sibling) // 全局变量进入符号表
+            if (t->nodekind == StmtK && t->kind.stmt == VarDeclarationK)
+                emitVariable(t->attr.name, t->memloc);
+#if DIRECT_CODE
+        codeGen(syntaxTree, codefile); // 由语法树直接生成 .tm 文件
+#else
+        ir = lowerProgram(syntaxTree); // 语法树 -> 三地址码
+        runIrPasses(ir, growth); // 尾递归消除、内联与 SSA 上的优化
+        allocateRegisters(ir); // 线性扫描寄存器分配
+        if (TraceIR) {
+            fprintf(listing, "\nIR:\n\n");
+            irPrintProgram(listing, ir);
+        }
+        if (native)
+            genX86(ir, codefile); // 生成 x86-64 汇编
+        else
+            selectProgram(ir, codefile, jobs); // 生成 .tm 文件（按函数并行选择指令）
+#endif
         fclose(code);
+        if (Error) // 生成代码出错时不留下不完整的代码文件
+            remove(codefile);
+        else if (TraceAnalyze)
+            printCodeSize(emitCount()); // 实际写出的 TM 指令数
     }
 #endif
+    if (!Error && TraceAnalyze)
+        printFrames(); // 按实际生成代码的栈帧估计数据内存
 #endif
+#endif
+#if !NO_ANALYZE
+    if (statistics)
+        printPassStatistics(stderr);
 #endif
     fclose(source);
-    return 0;
+    return Error ? 1 : 0;
 }
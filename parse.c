@@ -138,7 +138,9 @@ TreeNode *declaration()
         {
             t->child[0] = newExpNode(ParamK);
             t->child[0]->type = Void;
-            match(token);
+            if (token == VOID)
+                match(VOID);
+            match(RPAREN);
         }
         else
         {
@@ -0,0 +1,408 @@
+/****************************************************/
+/* File: passes.c                                   */
+/* Pass manager for the C-- compiler                */
+/****************************************************/
+
+#include <time.h>
+
+#include "globals.h"
+#include "util.h"
+#include "ir.h"
+#include "callgraph.h"
+#include "fold.h"
+#include "pure.h"
+#include "unroll.h"
+#include "tail.h"
+#include "inline.h"
+#include "ssa.h"
+#include "gvn.h"
+#include "loop.h"
+#include "passes.h"
+
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+/* a pass works on the syntax tree, on the whole
+ * IR program or on one function in SSA form
+ */
+typedef enum
+{
+    TreePass,
+    IrPass,
+    SsaPass
+} PassKind;
+
+typedef struct
+{
+    char *name;
+    PassKind kind;
+    int (*tree)(TreeNode **syntaxTree);
+    int (*ir)(IrProgram *p);
+    int (*ssa)(IrProgram *p, IrFunc *f);
+    char *what;
+} Pass;
+
+static int unrollFactor = UNROLL_FACTOR;
+static int inlineGrowth = INLINE_GROWTH;
+
+/**************************************************/
+/**********   the passes   ************************/
+/**************************************************/
+
+static int foldPass(TreeNode **syntaxTree)
+{
+    return foldConstants(*syntaxTree);
+}
+
+static int purePass(TreeNode **syntaxTree)
+{
+    int n;
+    classifyFunctions();
+    n = evalPureCalls(*syntaxTree);
+    if (n > 0)
+    {
+        /* the folded calls may leave helpers unused */
+        foldConstants(*syntaxTree);
+        buildCallGraph(*syntaxTree);
+        *syntaxTree = pruneCallGraph(*syntaxTree);
+    }
+    return n;
+}
+
+static int unrollPass(TreeNode **syntaxTree)
+{
+    int n = unrollLoops(*syntaxTree, unrollFactor);
+    if (n > 0)
+        foldConstants(*syntaxTree); /* fully unrolled counters are constants */
+    return n;
+}
+
+static int inlinePass(IrProgram *p)
+{
+    return inlineCalls(p, inlineGrowth);
+}
+
+/* the SSA passes that need only the function */
+static int sccpPass(IrProgram *p, IrFunc *f)
+{
+    (void)p;
+    return sccp(f);
+}
+
+static int copyPropPass(IrProgram *p, IrFunc *f)
+{
+    (void)p;
+    return copyProp(f);
+}
+
+static int adcePass(IrProgram *p, IrFunc *f)
+{
+    (void)p;
+    return adce(f);
+}
+
+static Pass passes[] = {
+    {"fold", TreePass, foldPass, NULL, NULL, "constant folding and propagation"},
+    {"pure", TreePass, purePass, NULL, NULL, "evaluation of pure calls on constants"},
+    {"unroll", TreePass, unrollPass, NULL, NULL, "unrolling of counted loops"},
+    {"tail", IrPass, NULL, eliminateTailCalls, NULL, "self tail calls into loops"},
+    {"inline", IrPass, NULL, inlinePass, NULL, "inlining of small functions"},
+    {"sccp", SsaPass, NULL, NULL, sccpPass, "sparse conditional constant propagation"},
+    {"copyprop", SsaPass, NULL, NULL, copyPropPass, "copy propagation"},
+    {"gvn", SsaPass, NULL, NULL, numberValues, "global value numbering"},
+    {"licm", SsaPass, NULL, NULL, hoistInvariants, "hoisting of loop invariants"},
+    {"strength", SsaPass, NULL, NULL, reduceStrength, "strength reduction"},
+    {"adce", SsaPass, NULL, NULL, adcePass, "aggressive dead code elimination"},
+    {NULL, TreePass, NULL, NULL, NULL, NULL}};
+
+/* the pipelines of the optimization levels */
+static char *levelPasses[MAX_OPT_LEVEL + 1] = {
+    "",
+    "fold,tail,sccp,copyprop,adce",
+    "fold,pure,unroll,tail,inline,sccp,copyprop,gvn,copyprop,licm,strength,copyprop,adce"};
+
+/**************************************************/
+/**********   the pipeline   **********************/
+/**************************************************/
+
+/* a pass in the pipeline, and what running it
+ * cost and changed; an SSA pass runs once per
+ * function and adds up
+ */
+typedef struct
+{
+    Pass *pass;
+    int runs;
+    int changes;
+    double time;   /* seconds */
+    long memory;   /* bytes */
+    long before;   /* size before and after: nodes */
+    long after;    /* of the tree, or IR instructions */
+} Stage;
+
+#define MAX_STAGES 64
+
+static Stage stages[MAX_STAGES];
+static int nstages = 0;
+
+/* the conversions into and out of SSA form */
+static Pass intoSSA = {"(into SSA)", SsaPass, NULL, NULL, NULL, NULL};
+static Pass outOfSSA = {"(out of SSA)", SsaPass, NULL, NULL, NULL, NULL};
+static Stage intoStage = {&intoSSA, 0, 0, 0.0, 0, 0, 0};
+static Stage outOfStage = {&outOfSSA, 0, 0, 0.0, 0, 0, 0};
+
+static double startTime;
+static long startMemory;
+
+/* Function memoryInUse returns the bytes the heap
+ * has handed out, or 0 where that is not known
+ */
+static long memoryInUse(void)
+{
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || __GLIBC_MINOR__ >= 33)
+    struct mallinfo2 mi = mallinfo2();
+    return (long)(mi.uordblks + mi.hblkhd);
+#else
+    return 0;
+#endif
+}
+
+static double wallTime(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void beginStage(void)
+{
+    startMemory = memoryInUse();
+    startTime = wallTime();
+}
+
+static void endStage(Stage *s, int changes, long before, long after)
+{
+    s->time += wallTime() - startTime;
+    s->memory += memoryInUse() - startMemory;
+    s->runs++;
+    s->changes += changes;
+    s->before += before;
+    s->after += after;
+}
+
+static long countNodes(TreeNode *t)
+{
+    long n = 0;
+    int i;
+    for (; t != NULL; t = t->sibling)
+    {
+        n++;
+        for (i = 0; i < MAXCHILDREN; i++)
+            n += countNodes(t->child[i]);
+    }
+    return n;
+}
+
+static Pass *findPass(char *name)
+{
+    Pass *p;
+    for (p = passes; p->name != NULL; p++)
+        if (strcmp(p->name, name) == 0)
+            return p;
+    return NULL;
+}
+
+static void listPasses(void)
+{
+    Pass *p;
+    int k;
+    fprintf(stderr, "the passes are:\n");
+    for (p = passes; p->name != NULL; p++)
+        fprintf(stderr, "  %-10s %s\n", p->name, p->what);
+    for (k = 0; k <= MAX_OPT_LEVEL; k++)
+        fprintf(stderr, "-O%d runs %s\n", k, *levelPasses[k] ? levelPasses[k] : "none");
+}
+
+/* Function selectPasses chooses the pipeline from
+ * a comma separated list of pass names, run in
+ * that order; the syntax tree passes must come
+ * first. It returns FALSE, after printing the
+ * passes there are, if the list is malformed
+ */
+int selectPasses(char *list)
+{
+    char *names = copyString(list);
+    char *name;
+    Pass *p;
+    nstages = 0;
+    for (name = strtok(names, ","); name != NULL; name = strtok(NULL, ","))
+    {
+        p = findPass(name);
+        if (p == NULL)
+        {
+            fprintf(stderr, "unknown pass %s; ", name);
+            listPasses();
+            free(names);
+            return FALSE;
+        }
+        if (p->kind == TreePass && nstages > 0 && stages[nstages - 1].pass->kind != TreePass)
+        {
+            fprintf(stderr, "pass %s works on the syntax tree and must come "
+                            "before the IR passes\n", name);
+            free(names);
+            return FALSE;
+        }
+        if (nstages == MAX_STAGES)
+        {
+            fprintf(stderr, "more than %d passes\n", MAX_STAGES);
+            free(names);
+            return FALSE;
+        }
+        memset(&stages[nstages], 0, sizeof(Stage));
+        stages[nstages++].pass = p;
+    }
+    free(names);
+    return TRUE;
+}
+
+/* Procedure selectOptLevel chooses the pipeline
+ * of optimization level level
+ */
+void selectOptLevel(int level)
+{
+    if (level > MAX_OPT_LEVEL)
+        level = MAX_OPT_LEVEL;
+    selectPasses(levelPasses[level]);
+}
+
+/* Function runTreePasses runs the syntax tree
+ * passes of the pipeline over syntaxTree, unrolling
+ * loops factor times, and returns the tree, from
+ * which unused functions may have been removed
+ */
+TreeNode *runTreePasses(TreeNode *syntaxTree, int factor)
+{
+    int k, n;
+    long before;
+    unrollFactor = factor;
+    for (k = 0; k < nstages && stages[k].pass->kind == TreePass; k++)
+    {
+        before = countNodes(syntaxTree);
+        beginStage();
+        n = stages[k].pass->tree(&syntaxTree);
+        endStage(&stages[k], n, before, countNodes(syntaxTree));
+    }
+    /* what the IR passes may assume of calls */
+    classifyFunctions();
+    return syntaxTree;
+}
+
+/* Procedure runSSAPasses runs the SSA passes
+ * stages[first .. last-1] over every function of p
+ */
+static void runSSAPasses(IrProgram *p, int first, int last)
+{
+    IrFunc *f;
+    int k, n;
+    long before, size;
+    if (TraceOpt)
+        fprintf(listing, "\nSSA optimization:\n");
+    for (f = p->funcs; f != NULL; f = f->next)
+    {
+        before = irCountFuncInstrs(f);
+        beginStage();
+        toSSA(f);
+        size = irCountFuncInstrs(f);
+        endStage(&intoStage, 0, before, size);
+        if (TraceOpt)
+            fprintf(listing, "%s: %ld instructions", f->name, before);
+        for (k = first; k < last; k++)
+        {
+            before = size;
+            beginStage();
+            n = stages[k].pass->ssa(p, f);
+            size = irCountFuncInstrs(f);
+            endStage(&stages[k], n, before, size);
+            if (TraceOpt)
+                fprintf(listing, ", %s %d", stages[k].pass->name, n);
+        }
+        beginStage();
+        fromSSA(f);
+        irSimplifyCFG(f);
+        before = size;
+        size = irCountFuncInstrs(f);
+        endStage(&outOfStage, 0, before, size);
+        if (TraceOpt)
+            fprintf(listing, ", %ld after SSA\n", size);
+    }
+}
+
+/* Procedure runIrPasses runs the IR passes of the
+ * pipeline over p, letting inlining grow it by at
+ * most growth percent; the runs of SSA passes
+ * each turn every function into SSA form and back
+ */
+void runIrPasses(IrProgram *p, int growth)
+{
+    int k, last, n;
+    long before;
+    inlineGrowth = growth;
+    for (k = 0; k < nstages && stages[k].pass->kind == TreePass; k++)
+        ;
+    while (k < nstages)
+    {
+        if (stages[k].pass->kind == IrPass)
+        {
+            before = irCountInstrs(p);
+            beginStage();
+            n = stages[k].pass->ir(p);
+            endStage(&stages[k], n, before, irCountInstrs(p));
+            k++;
+            continue;
+        }
+        for (last = k; last < nstages && stages[last].pass->kind == SsaPass; last++)
+            ;
+        runSSAPasses(p, k, last);
+        k = last;
+    }
+}
+
+static void printStage(FILE *out, Stage *s)
+{
+    fprintf(out, "%-14s %10.3f %+12.1f %8d %8ld -> %ld\n", s->pass->name,
+            s->time * 1000, s->memory / 1024.0, s->changes, s->before, s->after);
+}
+
+/* Procedure printPassStatistics writes the wall
+ * time, change of the memory in use and change of
+ * the program size of every pass run to out
+ */
+void printPassStatistics(FILE *out)
+{
+    Stage total;
+    int k;
+    memset(&total, 0, sizeof(total));
+    fprintf(out, "%-14s %10s %12s %8s %s\n", "pass", "time (ms)", "memory (KB)",
+            "changes", "size");
+    for (k = 0; k < nstages; k++)
+        if (stages[k].runs > 0)
+        {
+            printStage(out, &stages[k]);
+            total.time += stages[k].time;
+            total.memory += stages[k].memory;
+        }
+    for (k = 0; k < 2; k++)
+    {
+        Stage *s = k == 0 ? &intoStage : &outOfStage;
+        if (s->runs > 0)
+        {
+            printStage(out, s);
+            total.time += s->time;
+            total.memory += s->memory;
+        }
+    }
+    fprintf(out, "%-14s %10.3f %+12.1f\n", "total", total.time * 1000, total.memory / 1024.0);
+    fprintf(out, "(size: nodes of the syntax tree for the tree passes, "
+                 "IR instructions for the rest)\n");
+}
@@ -0,0 +1,51 @@
+/****************************************************/
+/* File: passes.h                                   */
+/* Pass manager for the C-- compiler                */
+/****************************************************/
+
+#ifndef _PASSES_H_
+#define _PASSES_H_
+
+#include "ir.h"
+
+/* OPT_LEVEL = the default optimization level; -O0
+ * runs no optional pass, -O1 the cheap ones and
+ * -O2 all of them
+ */
+#define OPT_LEVEL 2
+#define MAX_OPT_LEVEL 2
+
+/* Procedure selectOptLevel chooses the pipeline
+ * of optimization level level
+ */
+void selectOptLevel(int level);
+
+/* Function selectPasses chooses the pipeline from
+ * a comma separated list of pass names, run in
+ * that order; the syntax tree passes must come
+ * first. It returns FALSE, after printing the
+ * passes there are, if the list is malformed
+ */
+int selectPasses(char *list);
+
+/* Function runTreePasses runs the syntax tree
+ * passes of the pipeline over syntaxTree, unrolling
+ * loops factor times, and returns the tree, from
+ * which unused functions may have been removed
+ */
+TreeNode *runTreePasses(TreeNode *syntaxTree, int factor);
+
+/* Procedure runIrPasses runs the IR passes of the
+ * pipeline over p, letting inlining grow it by at
+ * most growth percent; the runs of SSA passes
+ * each turn every function into SSA form and back
+ */
+void runIrPasses(IrProgram *p, int growth);
+
+/* Procedure printPassStatistics writes the wall
+ * time, change of the memory in use and change of
+ * the program size of every pass run to out
+ */
+void printPassStatistics(FILE *out);
+
+#endif
@@ -0,0 +1,361 @@
+/****************************************************/
+/* File: pure.c                                     */
+/* Pure function classification and compile-time   */
+/* evaluation for the C-- compiler                  */
+/****************************************************/
+
+#include "globals.h"
+#include "util.h"
+#include "callgraph.h"
+#include "fold.h"
+#include "pure.h"
+
+/* MAXLOCALS = the number of parameters and local
+ * variables the interpreter keeps for one call
+ */
+#define MAXLOCALS 64
+
+/* MAXDEPTH = the deepest call nesting the
+ * interpreter follows
+ */
+#define MAXDEPTH 256
+
+/* per-function flags, indexed like the call graph */
+static int *pure = NULL;
+static int *readsGlobals = NULL;
+static int nclassified = 0;
+
+static int isLocal(TreeNode *decl)
+{
+    return decl != NULL && decl->scope > 0;
+}
+
+/* Procedure scanBody sets *impure if the tree t
+ * writes a global, does I/O or calls an impure or
+ * unknown function, and *reads if it reads a
+ * global or calls a function that does
+ */
+static void scanBody(TreeNode *t, int *impure, int *reads)
+{
+    while (t != NULL)
+    {
+        int i;
+        if (t->nodekind == StmtK && t->kind.stmt == AssignK && !isLocal(t->decl))
+            *impure = TRUE;
+        else if (t->nodekind == ExpK && t->kind.exp == IdK && !isLocal(t->decl))
+            *reads = TRUE;
+        else if (t->nodekind == ExpK && t->kind.exp == CallK)
+        {
+            int f = cg_lookup(t->attr.name);
+            if (f < 0) /* input, output or imported */
+                *impure = TRUE;
+            else
+            {
+                if (!pure[f])
+                    *impure = TRUE;
+                if (readsGlobals[f])
+                    *reads = TRUE;
+            }
+        }
+        for (i = 0; i < MAXCHILDREN; i++)
+            scanBody(t->child[i], impure, reads);
+        t = t->sibling;
+    }
+}
+
+/* Procedure classifyFunctions marks every function
+ * of the call graph as pure or impure; functions
+ * start out pure and lose the property until
+ * nothing changes, so recursion is handled
+ */
+void classifyFunctions(void)
+{
+    int n = cg_count();
+    int changed = TRUE;
+    int f;
+    pure = realloc(pure, (n + 1) * sizeof(int));
+    readsGlobals = realloc(readsGlobals, (n + 1) * sizeof(int));
+    nclassified = n;
+    for (f = 0; f < n; f++)
+    {
+        pure[f] = TRUE;
+        readsGlobals[f] = FALSE;
+    }
+    while (changed)
+    {
+        changed = FALSE;
+        for (f = 0; f < n; f++)
+        {
+            int impure = !pure[f];
+            int reads = readsGlobals[f];
+            scanBody(cg_decl(f)->child[1], &impure, &reads);
+            if (impure == pure[f] || reads != readsGlobals[f])
+            {
+                pure[f] = !impure;
+                readsGlobals[f] = reads;
+                changed = TRUE;
+            }
+        }
+    }
+    if (TraceOpt)
+    {
+        fprintf(listing, "Pure functions:");
+        for (f = 0; f < n; f++)
+            if (pure[f])
+                fprintf(listing, " %s%s", cg_decl(f)->attr.name,
+                        readsGlobals[f] ? "(reads globals)" : "");
+        fprintf(listing, "\n");
+    }
+}
+
+/* Function isPureFunction returns TRUE if calls
+ * to the function called name have no side effects
+ */
+int isPureFunction(char *name)
+{
+    int f = cg_lookup(name);
+    return f >= 0 && f < nclassified && pure[f];
+}
+
+static int evaluable(char *name)
+{
+    int f = cg_lookup(name);
+    return f >= 0 && f < nclassified && pure[f] && !readsGlobals[f];
+}
+
+/**************************************************/
+/**********   the syntax tree interpreter   *******/
+/**************************************************/
+
+/* the parameters and locals of one call */
+typedef struct
+{
+    TreeNode *decl[MAXLOCALS];
+    int val[MAXLOCALS];
+    int set[MAXLOCALS];
+    int n;
+} Frame;
+
+/* outcome of executing a statement */
+typedef enum
+{
+    ExecNormal,
+    ExecReturn,
+    ExecFail
+} ExecResult;
+
+/* nodes left in the budget of the current call */
+static int steps = 0;
+
+static int frameSlot(Frame *fr, TreeNode *decl)
+{
+    int i;
+    for (i = 0; i < fr->n; i++)
+        if (fr->decl[i] == decl)
+            return i;
+    if (fr->n == MAXLOCALS)
+        return -1;
+    fr->decl[fr->n] = decl;
+    fr->set[fr->n] = FALSE;
+    return fr->n++;
+}
+
+static int evalCall(TreeNode *t, int *args, int nargs, int depth, int *val);
+
+/* Function evalExp evaluates the expression t into
+ * *val; it returns FALSE if t cannot be evaluated
+ * (reads an unset variable, divides by zero,
+ * exhausts the budget)
+ */
+static int evalExp(TreeNode *t, Frame *fr, int depth, int *val)
+{
+    int a, b, i;
+    if (t == NULL || --steps < 0)
+        return FALSE;
+    switch (t->kind.exp)
+    {
+    case ConstK:
+        *val = t->attr.val;
+        return TRUE;
+    case IdK:
+        if (!isLocal(t->decl))
+            return FALSE;
+        i = frameSlot(fr, t->decl);
+        if (i < 0 || !fr->set[i])
+            return FALSE;
+        *val = fr->val[i];
+        return TRUE;
+    case OpK:
+        return evalExp(t->child[0], fr, depth, &a) &&
+               evalExp(t->child[1], fr, depth, &b) &&
+               foldOp(t->attr.op, a, b, val);
+    case CallK:
+    {
+        int args[MAXLOCALS];
+        int n = 0;
+        TreeNode *arg;
+        for (arg = t->child[0]; arg != NULL; arg = arg->sibling)
+        {
+            if (n == MAXLOCALS || !evalExp(arg, fr, depth, &args[n]))
+                return FALSE;
+            n++;
+        }
+        return evalCall(t, args, n, depth + 1, val);
+    }
+    default:
+        return FALSE;
+    }
+}
+
+/* Function execStmt executes the statement list t;
+ * on return *val holds the returned value
+ */
+static ExecResult execStmt(TreeNode *t, Frame *fr, int depth, int *val)
+{
+    for (; t != NULL; t = t->sibling)
+    {
+        ExecResult r;
+        int v, i;
+        if (--steps < 0)
+            return ExecFail;
+        if (t->nodekind == ExpK)
+        {
+            if (t->kind.exp != CallK || !evalExp(t, fr, depth, &v))
+                return ExecFail;
+            continue;
+        }
+        switch (t->kind.stmt)
+        {
+        case AssignK:
+            if (!isLocal(t->decl) || !evalExp(t->child[0], fr, depth, &v))
+                return ExecFail;
+            i = frameSlot(fr, t->decl);
+            if (i < 0)
+                return ExecFail;
+            fr->val[i] = v;
+            fr->set[i] = TRUE;
+            break;
+        case VarDeclarationK:
+            i = frameSlot(fr, t);
+            if (i < 0)
+                return ExecFail;
+            fr->set[i] = FALSE;
+            break;
+        case CompoundK:
+            r = execStmt(t->child[0], fr, depth, val);
+            if (r == ExecNormal)
+                r = execStmt(t->child[1], fr, depth, val);
+            if (r != ExecNormal)
+                return r;
+            break;
+        case SelectionK:
+            if (!evalExp(t->child[0], fr, depth, &v))
+                return ExecFail;
+            r = execStmt(v ? t->child[1] : t->child[2], fr, depth, val);
+            if (r != ExecNormal)
+                return r;
+            break;
+        case WhileK:
+            for (;;)
+            {
+                if (!evalExp(t->child[0], fr, depth, &v))
+                    return ExecFail;
+                if (!v)
+                    break;
+                r = execStmt(t->child[1], fr, depth, val);
+                if (r != ExecNormal)
+                    return r;
+            }
+            break;
+        case ReturnK:
+            /* only int functions are evaluated */
+            if (t->child[0] == NULL)
+                return ExecFail;
+            if (!evalExp(t->child[0], fr, depth, val))
+                return ExecFail;
+            return ExecReturn;
+        default:
+            return ExecFail;
+        }
+    }
+    return ExecNormal;
+}
+
+/* Function evalCall interprets the call t with
+ * argument values args into *val
+ */
+static int evalCall(TreeNode *t, int *args, int nargs, int depth, int *val)
+{
+    TreeNode *fn = t->decl;
+    TreeNode *p;
+    Frame fr;
+    int i = 0;
+    if (fn == NULL || fn->type != Integer || depth > MAXDEPTH ||
+        !evaluable(t->attr.name) || paramCount(fn->child[0]) != nargs)
+        return FALSE;
+    fr.n = 0;
+    for (p = fn->child[0]; p != NULL && i < nargs; p = p->sibling)
+    {
+        int slot = frameSlot(&fr, p);
+        if (slot < 0)
+            return FALSE;
+        fr.val[slot] = args[i++];
+        fr.set[slot] = TRUE;
+    }
+    return execStmt(fn->child[1], &fr, depth, val) == ExecReturn;
+}
+
+/* number of calls replaced so far */
+static int evaluated = 0;
+
+/* Procedure rewriteCalls replaces the calls in t
+ * that can be evaluated, innermost first
+ */
+static void rewriteCalls(TreeNode *t)
+{
+    while (t != NULL)
+    {
+        int i;
+        for (i = 0; i < MAXCHILDREN; i++)
+            rewriteCalls(t->child[i]);
+        if (t->nodekind == ExpK && t->kind.exp == CallK && evaluable(t->attr.name))
+        {
+            int args[MAXLOCALS];
+            int n = 0, val;
+            TreeNode *arg;
+            for (arg = t->child[0]; arg != NULL; arg = arg->sibling)
+            {
+                if (n == MAXLOCALS || arg->kind.exp != ConstK)
+                    break;
+                args[n++] = arg->attr.val;
+            }
+            steps = EVAL_BUDGET;
+            if (arg == NULL && evalCall(t, args, n, 0, &val))
+            {
+                if (TraceOpt)
+                    fprintf(listing, "line %d: %s(...) evaluated to %d\n",
+                            t->lineno, t->attr.name, val);
+                for (i = 0; i < MAXCHILDREN; i++)
+                    t->child[i] = NULL;
+                t->kind.exp = ConstK;
+                t->attr.val = val;
+                t->decl = NULL;
+                evaluated++;
+            }
+        }
+        t = t->sibling;
+    }
+}
+
+/* Function evalPureCalls replaces every call of a
+ * pure function that does not read globals and
+ * whose arguments are all constants by its value
+ */
+int evalPureCalls(TreeNode *syntaxTree)
+{
+    evaluated = 0;
+    rewriteCalls(syntaxTree);
+    if (TraceOpt)
+        fprintf(listing, "Compile-time evaluation: %d calls replaced\n", evaluated);
+    return evaluated;
+}
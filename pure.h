@@ -0,0 +1,35 @@
+/****************************************************/
+/* File: pure.h                                     */
+/* Pure function classification and compile-time   */
+/* evaluation for the C-- compiler                  */
+/****************************************************/
+
+#ifndef _PURE_H_
+#define _PURE_H_
+
+/* EVAL_BUDGET = the number of syntax tree nodes
+ * the interpreter may visit for one call before
+ * giving up on evaluating it at compile time
+ */
+#define EVAL_BUDGET 100000
+
+/* Procedure classifyFunctions marks every function
+ * of the call graph as pure (no global writes, no
+ * I/O, only calls to pure functions) or impure
+ */
+void classifyFunctions(void);
+
+/* Function isPureFunction returns TRUE if calls
+ * to the function called name have no side effects
+ */
+int isPureFunction(char *name);
+
+/* Function evalPureCalls replaces every call of a
+ * pure function that does not read globals and
+ * whose arguments are all constants by its value,
+ * computed by interpreting the callee; it returns
+ * the number of calls replaced
+ */
+int evalPureCalls(TreeNode *syntaxTree);
+
+#endif
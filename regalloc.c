@@ -0,0 +1,342 @@
+/****************************************************/
+/* File: regalloc.c                                 */
+/* Linear-scan register allocation of the IR        */
+/* temporaries for the C-- compiler                 */
+/****************************************************/
+
+#include <limits.h>
+#include "globals.h"
+#include "ir.h"
+#include "callgraph.h"
+#include "frame.h"
+#include "regalloc.h"
+
+/* the live interval of one temporary, in
+ * instruction positions: instruction k reads its
+ * operands at 2k and writes its result at 2k+1
+ */
+typedef struct
+{
+    int temp;
+    int start, end;
+    int weight; /* uses and definitions, scaled by loop depth */
+} Interval;
+
+/* liveness bitsets, words per set */
+static unsigned *liveIn = NULL, *liveOut = NULL;
+static int words = 0;
+
+#define BIT_SET(s, t) ((s)[(t) >> 5] |= 1u << ((t) & 31))
+#define BIT_CLR(s, t) ((s)[(t) >> 5] &= ~(1u << ((t) & 31)))
+#define BIT_GET(s, t) (((s)[(t) >> 5] >> ((t) & 31)) & 1)
+
+static void operandUses(IrOperand o, unsigned *live)
+{
+    if (o.kind == OpdTemp)
+        BIT_SET(live, o.val);
+}
+
+/* Procedure transfer applies the instructions of
+ * b backwards to the set live
+ */
+static void transfer(IrBlock *b, unsigned *live)
+{
+    IrInstr *i;
+    int k;
+    for (i = b->last; i != NULL; i = i->prev)
+    {
+        int d = irDef(i);
+        if (d >= 0)
+            BIT_CLR(live, d);
+        operandUses(i->a, live);
+        operandUses(i->b, live);
+        for (k = 0; k < i->nargs; k++)
+            operandUses(i->args[k], live);
+    }
+}
+
+/* Procedure computeLiveness finds the temporaries
+ * live on entry to and exit from every block
+ */
+static void computeLiveness(IrFunc *f)
+{
+    int n = f->nblocks, k, j, w, changed = TRUE;
+    unsigned *tmp;
+    words = (f->ntemps + 31) / 32 + 1;
+    liveIn = realloc(liveIn, n * words * sizeof(unsigned));
+    liveOut = realloc(liveOut, n * words * sizeof(unsigned));
+    memset(liveIn, 0, n * words * sizeof(unsigned));
+    memset(liveOut, 0, n * words * sizeof(unsigned));
+    tmp = (unsigned *)malloc(words * sizeof(unsigned));
+    while (changed)
+    {
+        changed = FALSE;
+        for (k = n - 1; k >= 0; k--)
+        {
+            IrBlock *b = f->blocks[k];
+            unsigned *out = liveOut + k * words;
+            unsigned *in = liveIn + k * words;
+            for (j = 0; j < b->nsucc; j++)
+                for (w = 0; w < words; w++)
+                    out[w] |= liveIn[b->succ[j]->id * words + w];
+            memcpy(tmp, out, words * sizeof(unsigned));
+            transfer(b, tmp);
+            if (memcmp(tmp, in, words * sizeof(unsigned)) != 0)
+            {
+                memcpy(in, tmp, words * sizeof(unsigned));
+                changed = TRUE;
+            }
+        }
+    }
+    free(tmp);
+}
+
+/* Function loopWeight returns 10 to the number of
+ * loops around block k; blocks are laid out in
+ * source order, so a loop spans the blocks from
+ * its header to the block jumping back to it
+ */
+static int loopWeight(IrFunc *f, int k)
+{
+    int j, w = 1;
+    for (j = k; j < f->nblocks; j++)
+    {
+        IrBlock *b = f->blocks[j];
+        int s;
+        for (s = 0; s < b->nsucc; s++)
+            if (b->succ[s]->id <= k && w < 100000)
+                w *= 10;
+    }
+    return w;
+}
+
+static Interval *iv = NULL;
+
+static void extend(int t, int pos, int weight)
+{
+    if (pos < iv[t].start)
+        iv[t].start = pos;
+    if (pos > iv[t].end)
+        iv[t].end = pos;
+    iv[t].weight += weight;
+}
+
+static void touchOperand(IrOperand o, int pos, int weight)
+{
+    if (o.kind == OpdTemp)
+        extend(o.val, pos, weight);
+}
+
+/* Procedure buildIntervals gives every temporary
+ * one interval covering all the positions where
+ * it is live
+ */
+static void buildIntervals(IrFunc *f)
+{
+    int k, t, pos = 0;
+    iv = realloc(iv, (f->ntemps + 1) * sizeof(Interval));
+    for (t = 0; t < f->ntemps; t++)
+    {
+        iv[t].temp = t;
+        iv[t].start = t < f->nparams ? -1 : INT_MAX;
+        iv[t].end = -1;
+        iv[t].weight = 0;
+    }
+    for (k = 0; k < f->nblocks; k++)
+    {
+        IrBlock *b = f->blocks[k];
+        int w = loopWeight(f, k);
+        int first = pos;
+        IrInstr *i;
+        int a;
+        for (i = b->first; i != NULL; i = i->next, pos++)
+        {
+            int d = irDef(i);
+            touchOperand(i->a, 2 * pos, w);
+            touchOperand(i->b, 2 * pos, w);
+            for (a = 0; a < i->nargs; a++)
+                touchOperand(i->args[a], 2 * pos, w);
+            if (d >= 0)
+                extend(d, 2 * pos + 1, w);
+        }
+        for (t = 0; t < f->ntemps; t++)
+        {
+            if (BIT_GET(liveIn + k * words, t))
+                extend(t, 2 * first, 0);
+            if (BIT_GET(liveOut + k * words, t))
+                extend(t, 2 * pos - 1, 0);
+        }
+    }
+}
+
+/* Function density returns the spill cost of an
+ * interval per position it covers: spilling a
+ * long interval used rarely frees a register for
+ * longest at the least cost
+ */
+static double density(Interval *v)
+{
+    return (double)v->weight / (v->end - v->start + 1);
+}
+
+static int byStart(const void *x, const void *y)
+{
+    const Interval *a = (const Interval *)x, *b = (const Interval *)y;
+    if (a->start != b->start)
+        return a->start < b->start ? -1 : 1;
+    return a->temp - b->temp;
+}
+
+/* copied[t] is a temporary copied into t, or -1;
+ * t prefers its register so the copy disappears
+ */
+static int *copied = NULL;
+
+static void findCopies(IrFunc *f)
+{
+    int k, t;
+    copied = realloc(copied, (f->ntemps + 1) * sizeof(int));
+    for (t = 0; t < f->ntemps; t++)
+        copied[t] = -1;
+    for (k = 0; k < f->nblocks; k++)
+    {
+        IrInstr *i;
+        for (i = f->blocks[k]->first; i != NULL; i = i->next)
+            if (i->op == IrMov && i->a.kind == OpdTemp)
+                copied[i->dst.val] = i->a.val;
+    }
+}
+
+/* Procedure linearScan walks the intervals by
+ * increasing start, giving each a free register;
+ * when none is free the interval of least spill
+ * cost density among the active ones and the new
+ * one goes to memory
+ */
+static void linearScan(IrFunc *f)
+{
+    Interval *sorted = (Interval *)malloc((f->ntemps + 1) * sizeof(Interval));
+    Interval *active[NUM_REGS];
+    int owner[NUM_REGS];
+    int nactive = 0, n = 0, k, j;
+    for (k = 0; k < NUM_REGS; k++)
+        owner[k] = -1;
+    for (k = 0; k < f->ntemps; k++)
+    {
+        f->reg[k] = -1;
+        if (iv[k].end >= 0)
+            sorted[n++] = iv[k];
+    }
+    qsort(sorted, n, sizeof(Interval), byStart);
+    findCopies(f);
+    for (k = 0; k < n; k++)
+    {
+        Interval *cur = &sorted[k];
+        int r, hint;
+        /* expire the intervals that ended */
+        for (j = 0; j < nactive;)
+            if (active[j]->end < cur->start)
+            {
+                owner[f->reg[active[j]->temp] - FIRST_REG] = -1;
+                active[j] = active[--nactive];
+            }
+            else
+                j++;
+        hint = copied[cur->temp] >= 0 ? f->reg[copied[cur->temp]] : -1;
+        r = -1;
+        if (hint >= 0 && owner[hint - FIRST_REG] < 0)
+            r = hint;
+        for (j = 0; j < NUM_REGS && r < 0; j++)
+            if (owner[j] < 0)
+                r = FIRST_REG + j;
+        if (r < 0)
+        {
+            int victim = 0;
+            for (j = 1; j < nactive; j++)
+                if (density(active[j]) < density(active[victim]) ||
+                    (density(active[j]) == density(active[victim]) &&
+                     active[j]->end > active[victim]->end))
+                    victim = j;
+            if (density(active[victim]) >= density(cur))
+                continue; /* cur stays in memory */
+            r = f->reg[active[victim]->temp];
+            f->reg[active[victim]->temp] = -1;
+            active[victim] = active[--nactive];
+        }
+        f->reg[cur->temp] = r;
+        owner[r - FIRST_REG] = cur->temp;
+        active[nactive++] = cur;
+    }
+    free(sorted);
+}
+
+/* Procedure layoutFrame gives the temporaries
+ * left in memory their frame words and marks
+ * the registers live across every call
+ */
+static void layoutFrame(IrFunc *f)
+{
+    int k, t, pos = 0, next, saves = FALSE;
+    for (t = 0; t < f->ntemps; t++)
+        f->slot[t] = t < f->nparams ? -1 - t : 0;
+    next = -1 - f->nparams;
+    for (t = f->nparams; t < f->ntemps; t++)
+        if (f->reg[t] < 0 && iv[t].end >= 0)
+            f->slot[t] = next--;
+    for (k = 0; k < f->nblocks; k++)
+    {
+        IrInstr *i;
+        for (i = f->blocks[k]->first; i != NULL; i = i->next, pos++)
+        {
+            if (i->op != IrCall)
+                continue;
+            i->saved = 0;
+            /* a temporary live into the block starts at
+             * the block's first position and one live out
+             * of it ends at its last, so both bounds count */
+            for (t = 0; t < f->ntemps; t++)
+                if (f->reg[t] >= 0 && iv[t].start <= 2 * pos && iv[t].end >= 2 * pos + 1)
+                    i->saved |= 1 << f->reg[t];
+            if (i->saved)
+                saves = TRUE;
+        }
+    }
+    f->saveBase = next;
+    if (saves)
+        next -= NUM_REGS;
+    f->frameSize = -next;
+}
+
+void allocateRegisters(IrProgram *p)
+{
+    IrFunc *f;
+    int k;
+    if (TraceOpt)
+        fprintf(listing, "\nRegister allocation:\n");
+    /* the frames replace those of frame.c; functions
+     * inlining dropped have none */
+    for (k = 0; k < cg_count(); k++)
+        setFrameSize(k, 0);
+    for (f = p->funcs; f != NULL; f = f->next)
+    {
+        int t, inRegs = 0, used = 0;
+        f->reg = realloc(f->reg, (f->ntemps + 1) * sizeof(int));
+        f->slot = realloc(f->slot, (f->ntemps + 1) * sizeof(int));
+        computeLiveness(f);
+        buildIntervals(f);
+        linearScan(f);
+        layoutFrame(f);
+        if (cg_lookup(f->name) >= 0)
+            setFrameSize(cg_lookup(f->name), f->frameSize);
+        if (TraceOpt)
+        {
+            for (t = 0; t < f->ntemps; t++)
+            {
+                used += iv[t].end >= 0;
+                inRegs += f->reg[t] >= 0;
+            }
+            fprintf(listing, "%s: %d of %d temporaries in registers, frame %d words\n",
+                    f->name, inRegs, used, f->frameSize);
+        }
+    }
+}
@@ -0,0 +1,29 @@
+/****************************************************/
+/* File: regalloc.h                                 */
+/* Linear-scan register allocation of the IR        */
+/* temporaries for the C-- compiler                 */
+/****************************************************/
+
+#ifndef _REGALLOC_H_
+#define _REGALLOC_H_
+
+#include "ir.h"
+
+/* FIRST_REG and LAST_REG bound the TM registers
+ * the allocator hands out; ac and ac1 stay free
+ * for instruction selection and the return
+ * address, gp, mp and pc are reserved
+ */
+#define FIRST_REG 2
+#define LAST_REG 4
+#define NUM_REGS (LAST_REG - FIRST_REG + 1)
+
+/* Procedure allocateRegisters assigns a register
+ * or a frame word to every temporary of every
+ * function of p (which must be out of SSA form)
+ * and lays out the frames, whose sizes it
+ * records with setFrameSize
+ */
+void allocateRegisters(IrProgram *p);
+
+#endif
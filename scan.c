@@ -262,6 +262,7 @@ TokenType getToken(void)
             else
             { // INCOMMENT1 状态下没有接收到 / 则表示是除号
                 ungetNextChar();
+                state = DONE;
                 currentToken = OVER;
             }
             break;
@@ -0,0 +1,1093 @@
+/****************************************************/
+/* File: ssa.c                                      */
+/* SSA construction, sparse conditional constant    */
+/* propagation and dead-code elimination on the IR  */
+/****************************************************/
+
+#include "globals.h"
+#include "ir.h"
+#include "ssa.h"
+#include "gvn.h"
+#include "loop.h"
+
+/**************************************************/
+/***********   dominators                ***********/
+/**************************************************/
+
+static IrBlock **order = NULL; /* blocks in postorder */
+static int norder = 0;
+
+static void postorder(IrBlock *b)
+{
+    int k;
+    b->mark = TRUE;
+    for (k = 0; k < b->nsucc; k++)
+        if (!b->succ[k]->mark)
+            postorder(b->succ[k]);
+    order[norder++] = b;
+}
+
+static IrBlock *intersect(IrBlock *a, IrBlock *b)
+{
+    while (a != b)
+    {
+        while (a->rpo > b->rpo)
+            a = a->idom;
+        while (b->rpo > a->rpo)
+            b = b->idom;
+    }
+    return a;
+}
+
+/* Procedure computeDominators uses the iterative
+ * algorithm of Cooper, Harvey and Kennedy over the
+ * blocks in reverse postorder
+ */
+void computeDominators(IrFunc *f)
+{
+    int k, j, changed = TRUE;
+    IrBlock *entry = f->blocks[0];
+    order = realloc(order, (f->nblocks + 1) * sizeof(IrBlock *));
+    norder = 0;
+    for (k = 0; k < f->nblocks; k++)
+    {
+        f->blocks[k]->mark = FALSE;
+        f->blocks[k]->idom = NULL;
+    }
+    postorder(entry);
+    for (k = 0; k < norder; k++)
+    {
+        order[k]->rpo = norder - 1 - k;
+        order[k]->mark = FALSE;
+    }
+    entry->idom = entry;
+    while (changed)
+    {
+        changed = FALSE;
+        for (k = norder - 2; k >= 0; k--)
+        {
+            IrBlock *b = order[k];
+            IrBlock *idom = NULL;
+            for (j = 0; j < b->npred; j++)
+            {
+                IrBlock *p = b->pred[j];
+                if (p->idom == NULL)
+                    continue;
+                idom = idom == NULL ? p : intersect(p, idom);
+            }
+            if (b->idom != idom)
+            {
+                b->idom = idom;
+                changed = TRUE;
+            }
+        }
+    }
+    entry->domDepth = 0;
+    for (k = norder - 2; k >= 0; k--)
+        order[k]->domDepth = order[k]->idom->domDepth + 1;
+}
+
+int dominates(IrBlock *a, IrBlock *b)
+{
+    while (b->domDepth > a->domDepth)
+        b = b->idom;
+    return a == b;
+}
+
+/**************************************************/
+/***********   SSA construction          ***********/
+/**************************************************/
+
+/* renaming stacks, one per variable */
+static int **stack = NULL;
+static int *depth = NULL;
+static int *room = NULL;
+/* variables pushed, in order, so blocks can pop theirs */
+static int *pushed = NULL;
+static int npushed = 0, maxpushed = 0;
+/* children of every block in the dominator tree */
+static IrBlock ***kids = NULL;
+static int *nkids = NULL;
+
+static void push(int v, int t)
+{
+    if (depth[v] == room[v])
+    {
+        room[v] = room[v] ? 2 * room[v] : 4;
+        stack[v] = realloc(stack[v], room[v] * sizeof(int));
+    }
+    stack[v][depth[v]++] = t;
+    if (npushed == maxpushed)
+    {
+        maxpushed = maxpushed ? 2 * maxpushed : 64;
+        pushed = realloc(pushed, maxpushed * sizeof(int));
+    }
+    pushed[npushed++] = v;
+}
+
+/* Function current returns the operand naming the
+ * reaching definition of variable v; a variable
+ * read before any assignment reads 0
+ */
+static IrOperand current(int v)
+{
+    return depth[v] > 0 ? irTemp(stack[v][depth[v] - 1]) : irConst(0);
+}
+
+static void renameUse(IrOperand *o, int nvars)
+{
+    if (o->kind == OpdTemp && o->val < nvars)
+        *o = current(o->val);
+}
+
+static int predIndex(IrBlock *s, IrBlock *p, int which)
+{
+    int j;
+    for (j = 0; j < s->npred; j++)
+        if (s->pred[j] == p && which-- == 0)
+            return j;
+    return -1;
+}
+
+/* Procedure renameBlock walks the dominator tree from b
+ * giving every definition a new temporary and
+ * every use the temporary of its reaching
+ * definition
+ */
+static void renameBlock(IrFunc *f, IrBlock *b, int nvars)
+{
+    int mark = npushed, k;
+    IrInstr *i;
+    for (i = b->first; i != NULL; i = i->next)
+    {
+        int v;
+        if (i->op != IrPhi)
+        {
+            renameUse(&i->a, nvars);
+            renameUse(&i->b, nvars);
+            for (k = 0; k < i->nargs; k++)
+                renameUse(&i->args[k], nvars);
+        }
+        v = irDef(i);
+        if (v >= 0 && v < nvars)
+        {
+            int t = irNewTemp(f);
+            push(v, t);
+            i->dst = irTemp(t);
+        }
+    }
+    for (k = 0; k < b->nsucc; k++)
+    {
+        IrBlock *s = b->succ[k];
+        int j = predIndex(s, b, k > 0 && b->succ[0] == s);
+        for (i = s->first; i != NULL && i->op == IrPhi; i = i->next)
+            i->args[j] = current(i->sym);
+    }
+    for (k = 0; k < nkids[b->id]; k++)
+        renameBlock(f, kids[b->id][k], nvars);
+    while (npushed > mark)
+        depth[pushed[--npushed]]--;
+}
+
+void toSSA(IrFunc *f)
+{
+    int n = f->nblocks, nvars = f->ntemps;
+    int v, k, j;
+    char *df = (char *)calloc(n * n + 1, 1);  /* df[b*n+y]: y in DF(b) */
+    char *defs = (char *)calloc(n * nvars + 1, 1); /* defs[v*n+b] */
+    char *global = (char *)calloc(nvars + 1, 1);
+    int *phiAt = (int *)calloc(n + 1, sizeof(int));
+    int *inWork = (int *)calloc(n + 1, sizeof(int));
+    int *work = (int *)malloc((n + 1) * sizeof(int));
+    char *killed = (char *)calloc(nvars + 1, 1);
+
+    computeDominators(f);
+    /* dominance frontiers */
+    for (k = 0; k < n; k++)
+    {
+        IrBlock *b = f->blocks[k];
+        if (b->npred < 2)
+            continue;
+        for (j = 0; j < b->npred; j++)
+        {
+            IrBlock *r = b->pred[j];
+            while (r != b->idom)
+            {
+                df[r->id * n + b->id] = TRUE;
+                r = r->idom;
+            }
+        }
+    }
+    /* definition sites, and the variables live
+     * across blocks (semi-pruned form)
+     */
+    for (v = 0; v < f->nparams; v++)
+        defs[v * n] = TRUE;
+    for (k = 0; k < n; k++)
+    {
+        IrInstr *i;
+        memset(killed, 0, nvars);
+        for (i = f->blocks[k]->first; i != NULL; i = i->next)
+        {
+            int uses[2 + 64];
+            int *u = i->nargs > 64 ? malloc((2 + i->nargs) * sizeof(int)) : uses;
+            int nu = irUses(i, u), d;
+            for (j = 0; j < nu; j++)
+                if (!killed[u[j]])
+                    global[u[j]] = TRUE;
+            if (u != uses)
+                free(u);
+            d = irDef(i);
+            if (d >= 0)
+            {
+                killed[d] = TRUE;
+                defs[d * n + k] = TRUE;
+            }
+        }
+    }
+    /* phi placement on the iterated frontiers */
+    for (v = 0; v < nvars; v++)
+    {
+        int nwork = 0;
+        if (!global[v])
+            continue;
+        for (k = 0; k < n; k++)
+            if (defs[v * n + k])
+            {
+                work[nwork++] = k;
+                inWork[k] = v + 1;
+            }
+        while (nwork > 0)
+        {
+            int b = work[--nwork];
+            for (k = 0; k < n; k++)
+            {
+                IrBlock *y;
+                IrInstr *phi;
+                if (!df[b * n + k] || phiAt[k] == v + 1)
+                    continue;
+                y = f->blocks[k];
+                phi = irNewInstr(IrPhi, irTemp(v), irNone(), irNone());
+                phi->sym = v;
+                phi->nargs = y->npred;
+                phi->args = (IrOperand *)malloc(y->npred * sizeof(IrOperand));
+                for (j = 0; j < y->npred; j++)
+                    phi->args[j] = irTemp(v);
+                irInsertBefore(y, y->first, phi);
+                phiAt[k] = v + 1;
+                if (inWork[k] != v + 1)
+                {
+                    inWork[k] = v + 1;
+                    work[nwork++] = k;
+                }
+            }
+        }
+    }
+    /* renaming */
+    stack = realloc(stack, (nvars + 1) * sizeof(int *));
+    depth = realloc(depth, (nvars + 1) * sizeof(int));
+    room = realloc(room, (nvars + 1) * sizeof(int));
+    for (v = 0; v < nvars; v++)
+    {
+        stack[v] = NULL;
+        depth[v] = room[v] = 0;
+    }
+    kids = realloc(kids, (n + 1) * sizeof(IrBlock **));
+    nkids = realloc(nkids, (n + 1) * sizeof(int));
+    for (k = 0; k < n; k++)
+    {
+        kids[k] = (IrBlock **)malloc((n + 1) * sizeof(IrBlock *));
+        nkids[k] = 0;
+    }
+    for (k = 1; k < n; k++)
+    {
+        IrBlock *b = order[norder - 1 - k];
+        kids[b->idom->id][nkids[b->idom->id]++] = b;
+    }
+    npushed = 0;
+    for (v = 0; v < f->nparams; v++)
+        push(v, v);
+    renameBlock(f, f->blocks[0], nvars);
+    for (v = 0; v < nvars; v++)
+        free(stack[v]);
+    for (k = 0; k < n; k++)
+        free(kids[k]);
+    free(df);
+    free(defs);
+    free(global);
+    free(phiAt);
+    free(inWork);
+    free(work);
+    free(killed);
+}
+
+/**************************************************/
+/***********   def-use information       ***********/
+/**************************************************/
+
+typedef struct
+{
+    IrInstr *instr;
+    IrBlock *block;
+} Site;
+
+static Site *defSite = NULL;  /* by temporary */
+static Site **useSites = NULL; /* by temporary */
+static int *nuses = NULL, *maxuses = NULL;
+
+static void addUse(int t, IrInstr *i, IrBlock *b)
+{
+    if (nuses[t] == maxuses[t])
+    {
+        maxuses[t] = maxuses[t] ? 2 * maxuses[t] : 4;
+        useSites[t] = realloc(useSites[t], maxuses[t] * sizeof(Site));
+    }
+    useSites[t][nuses[t]].instr = i;
+    useSites[t][nuses[t]].block = b;
+    nuses[t]++;
+}
+
+static void addOperandUse(IrOperand o, IrInstr *i, IrBlock *b)
+{
+    if (o.kind == OpdTemp)
+        addUse(o.val, i, b);
+}
+
+/* Procedure buildDefUse records the definition
+ * and the uses of every temporary of f
+ */
+static void buildDefUse(IrFunc *f)
+{
+    int t, k, j;
+    int n = f->ntemps;
+    static int built = 0;
+    for (t = 0; t < built; t++)
+        free(useSites[t]);
+    defSite = realloc(defSite, (n + 1) * sizeof(Site));
+    useSites = realloc(useSites, (n + 1) * sizeof(Site *));
+    nuses = realloc(nuses, (n + 1) * sizeof(int));
+    maxuses = realloc(maxuses, (n + 1) * sizeof(int));
+    built = n;
+    for (t = 0; t < n; t++)
+    {
+        defSite[t].instr = NULL;
+        defSite[t].block = NULL;
+        useSites[t] = NULL;
+        nuses[t] = maxuses[t] = 0;
+    }
+    for (k = 0; k < f->nblocks; k++)
+    {
+        IrBlock *b = f->blocks[k];
+        IrInstr *i;
+        for (i = b->first; i != NULL; i = i->next)
+        {
+            int d = irDef(i);
+            if (d >= 0)
+            {
+                defSite[d].instr = i;
+                defSite[d].block = b;
+            }
+            addOperandUse(i->a, i, b);
+            addOperandUse(i->b, i, b);
+            for (j = 0; j < i->nargs; j++)
+                addOperandUse(i->args[j], i, b);
+        }
+    }
+}
+
+/**************************************************/
+/***********   constant propagation      ***********/
+/**************************************************/
+
+/* lattice values */
+#define TOP 0
+#define CONST 1
+#define BOTTOM 2
+
+static int *lat = NULL, *latVal = NULL;
+static char *blockExec = NULL;
+static char *edgeExec = NULL; /* edgeExec[2*b+k]: edge to succ[k] of b */
+static int *flowWork = NULL;  /* pending edges as 2*b+k */
+static int nflow = 0;
+static int *ssaWork = NULL;   /* temporaries whose value dropped */
+static int nssa = 0;
+
+static void addEdge(IrBlock *b, int k)
+{
+    if (!edgeExec[2 * b->id + k])
+        flowWork[nflow++] = 2 * b->id + k;
+}
+
+static int edgeInto(IrBlock *s, int j)
+{
+    IrBlock *p = s->pred[j];
+    return edgeExec[2 * p->id + (p->succ[0] == s ? 0 : 1)];
+}
+
+/* Procedure operandValue gives the lattice value
+ * of operand o
+ */
+static void operandValue(IrOperand o, int *l, int *v)
+{
+    if (o.kind == OpdConst)
+    {
+        *l = CONST;
+        *v = o.val;
+    }
+    else if (o.kind == OpdTemp)
+    {
+        *l = lat[o.val];
+        *v = latVal[o.val];
+    }
+    else
+    {
+        *l = BOTTOM;
+        *v = 0;
+    }
+}
+
+static void lower(int t, int l, int v)
+{
+    if (l <= lat[t])
+        return;
+    lat[t] = l;
+    latVal[t] = v;
+    ssaWork[nssa++] = t;
+}
+
+static void visit(IrBlock *b, IrInstr *i)
+{
+    int la, va, lb, vb, r, j, d = irDef(i);
+    switch (i->op)
+    {
+    case IrPhi:
+    {
+        int l = TOP, v = 0;
+        for (j = 0; j < i->nargs && l != BOTTOM; j++)
+        {
+            if (!edgeInto(b, j))
+                continue;
+            operandValue(i->args[j], &la, &va);
+            if (la == TOP)
+                continue;
+            if (la == BOTTOM || (l == CONST && v != va))
+                l = BOTTOM;
+            else
+            {
+                l = CONST;
+                v = va;
+            }
+        }
+        lower(d, l, v);
+        break;
+    }
+    case IrMov:
+        operandValue(i->a, &la, &va);
+        lower(d, la, va);
+        break;
+    case IrAdd:
+    case IrSub:
+    case IrMul:
+    case IrDiv:
+    case IrLt:
+    case IrLe:
+    case IrGt:
+    case IrGe:
+    case IrEq:
+    case IrNe:
+        operandValue(i->a, &la, &va);
+        operandValue(i->b, &lb, &vb);
+        if (la == BOTTOM || lb == BOTTOM)
+            lower(d, BOTTOM, 0);
+        else if (la == CONST && lb == CONST)
+        {
+            if (irFoldOp(i->op, va, vb, &r))
+                lower(d, CONST, r);
+            else
+                lower(d, BOTTOM, 0);
+        }
+        break;
+    case IrBranch:
+        operandValue(i->a, &la, &va);
+        operandValue(i->b, &lb, &vb);
+        if (la == CONST && lb == CONST && irFoldOp(i->cmp, va, vb, &r))
+            addEdge(b, r ? 0 : 1);
+        else if (la == BOTTOM || lb == BOTTOM)
+        {
+            addEdge(b, 0);
+            addEdge(b, 1);
+        }
+        break;
+    case IrJump:
+        addEdge(b, 0);
+        break;
+    default:
+        if (d >= 0)
+            lower(d, BOTTOM, 0);
+        break;
+    }
+}
+
+static void replaceConst(IrOperand *o)
+{
+    if (o->kind == OpdTemp && lat[o->val] == CONST)
+        *o = irConst(latVal[o->val]);
+}
+
+/* Function sccp follows Wegman and Zadeck: values
+ * start optimistically undefined and blocks
+ * unreachable, and only the executable edges feed
+ * the phis
+ */
+int sccp(IrFunc *f)
+{
+    int n = f->nblocks, t, k, j;
+    int before = irCountFuncInstrs(f);
+    buildDefUse(f);
+    lat = realloc(lat, (f->ntemps + 1) * sizeof(int));
+    latVal = realloc(latVal, (f->ntemps + 1) * sizeof(int));
+    ssaWork = realloc(ssaWork, (3 * f->ntemps + 1) * sizeof(int));
+    blockExec = realloc(blockExec, n + 1);
+    edgeExec = realloc(edgeExec, 2 * n + 1);
+    flowWork = realloc(flowWork, (2 * n + 1) * sizeof(int));
+    memset(blockExec, 0, n + 1);
+    memset(edgeExec, 0, 2 * n + 1);
+    nflow = nssa = 0;
+    for (t = 0; t < f->ntemps; t++)
+    {
+        lat[t] = t < f->nparams ? BOTTOM : TOP;
+        latVal[t] = 0;
+    }
+    blockExec[0] = TRUE;
+    {
+        IrInstr *i;
+        for (i = f->blocks[0]->first; i != NULL; i = i->next)
+            visit(f->blocks[0], i);
+    }
+    while (nflow > 0 || nssa > 0)
+    {
+        if (nflow > 0)
+        {
+            int e = flowWork[--nflow];
+            IrBlock *s;
+            IrInstr *i;
+            if (edgeExec[e])
+                continue;
+            edgeExec[e] = TRUE;
+            s = f->blocks[e / 2]->succ[e % 2];
+            for (i = s->first; i != NULL && i->op == IrPhi; i = i->next)
+                visit(s, i);
+            if (!blockExec[s->id])
+            {
+                blockExec[s->id] = TRUE;
+                for (; i != NULL; i = i->next)
+                    visit(s, i);
+            }
+        }
+        else
+        {
+            t = ssaWork[--nssa];
+            for (k = 0; k < nuses[t]; k++)
+                if (blockExec[useSites[t][k].block->id])
+                    visit(useSites[t][k].block, useSites[t][k].instr);
+        }
+    }
+    /* rewrite: constants replace their temporaries
+     * and one-way branches become jumps
+     */
+    for (k = 0; k < n; k++)
+    {
+        IrBlock *b = f->blocks[k];
+        IrInstr *i, *next;
+        if (!blockExec[k])
+            continue;
+        for (i = b->first; i != NULL; i = next)
+        {
+            int d = irDef(i);
+            next = i->next;
+            if (d >= 0 && lat[d] == CONST && !irHasSideEffects(i))
+            {
+                irRemove(b, i);
+                continue;
+            }
+            replaceConst(&i->a);
+            replaceConst(&i->b);
+            for (j = 0; j < i->nargs; j++)
+                replaceConst(&i->args[j]);
+            if (i->op == IrBranch && edgeExec[2 * k] != edgeExec[2 * k + 1])
+            {
+                int taken = edgeExec[2 * k] ? 0 : 1;
+                i->op = IrJump;
+                i->a = i->b = irNone();
+                irSetSuccs(b, b->succ[taken], NULL);
+            }
+        }
+    }
+    irBuildCFG(f);
+    /* a phi left with one predecessor is a copy */
+    for (k = 0; k < f->nblocks; k++)
+    {
+        IrInstr *i;
+        for (i = f->blocks[k]->first; i != NULL && i->op == IrPhi; i = i->next)
+            if (i->nargs == 1)
+            {
+                i->op = IrMov;
+                i->a = i->args[0];
+                i->nargs = 0;
+            }
+    }
+    return before - irCountFuncInstrs(f);
+}
+
+/**************************************************/
+/***********   copy propagation          ***********/
+/**************************************************/
+
+static IrOperand *copyOf = NULL;
+
+static IrOperand resolve(IrOperand o)
+{
+    while (o.kind == OpdTemp && copyOf[o.val].kind != OpdNone)
+        o = copyOf[o.val];
+    return o;
+}
+
+int copyProp(IrFunc *f)
+{
+    int k, j, t, removed = 0;
+    copyOf = realloc(copyOf, (f->ntemps + 1) * sizeof(IrOperand));
+    for (t = 0; t < f->ntemps; t++)
+        copyOf[t] = irNone();
+    for (k = 0; k < f->nblocks; k++)
+    {
+        IrInstr *i;
+        for (i = f->blocks[k]->first; i != NULL; i = i->next)
+            if (i->op == IrMov && i->dst.kind == OpdTemp && i->a.kind != OpdNone &&
+                !(i->a.kind == OpdTemp && i->a.val == i->dst.val))
+                copyOf[i->dst.val] = i->a;
+    }
+    for (k = 0; k < f->nblocks; k++)
+    {
+        IrBlock *b = f->blocks[k];
+        IrInstr *i, *next;
+        for (i = b->first; i != NULL; i = next)
+        {
+            next = i->next;
+            if (i->op == IrMov && i->dst.kind == OpdTemp &&
+                copyOf[i->dst.val].kind != OpdNone)
+            {
+                irRemove(b, i);
+                removed++;
+                continue;
+            }
+            i->a = resolve(i->a);
+            i->b = resolve(i->b);
+            for (j = 0; j < i->nargs; j++)
+                i->args[j] = resolve(i->args[j]);
+        }
+    }
+    return removed;
+}
+
+/**************************************************/
+/***********   dead-code elimination     ***********/
+/**************************************************/
+
+static int *ipdom = NULL; /* immediate postdominator, by block; n = exit */
+static int *prpo = NULL;  /* reverse postorder on the reverse graph */
+static int *porder = NULL;
+static int nporder = 0;
+static char *seen = NULL;
+
+/* Procedure rpostorder numbers the blocks that
+ * reach the exit, walking the edges backwards
+ */
+static void rpostorder(IrFunc *f, int b)
+{
+    int j;
+    seen[b] = TRUE;
+    if (b == f->nblocks)
+    {
+        for (j = 0; j < f->nblocks; j++)
+            if (f->blocks[j]->last->op == IrReturn && !seen[j])
+                rpostorder(f, j);
+    }
+    else
+        for (j = 0; j < f->blocks[b]->npred; j++)
+            if (!seen[f->blocks[b]->pred[j]->id])
+                rpostorder(f, f->blocks[b]->pred[j]->id);
+    porder[nporder++] = b;
+}
+
+static int pintersect(int a, int b)
+{
+    while (a != b)
+    {
+        while (prpo[a] > prpo[b])
+            a = ipdom[a];
+        while (prpo[b] > prpo[a])
+            b = ipdom[b];
+    }
+    return a;
+}
+
+/* Function postDominators computes ipdom for the
+ * blocks of f; it returns FALSE if some block
+ * cannot reach a return
+ */
+static int postDominators(IrFunc *f)
+{
+    int n = f->nblocks, k, j, changed = TRUE;
+    ipdom = realloc(ipdom, (n + 1) * sizeof(int));
+    prpo = realloc(prpo, (n + 1) * sizeof(int));
+    porder = realloc(porder, (n + 1) * sizeof(int));
+    seen = realloc(seen, n + 1);
+    memset(seen, 0, n + 1);
+    nporder = 0;
+    rpostorder(f, n);
+    if (nporder != n + 1)
+        return FALSE;
+    for (k = 0; k <= n; k++)
+    {
+        prpo[porder[k]] = n - k;
+        ipdom[k] = -1;
+    }
+    ipdom[n] = n;
+    while (changed)
+    {
+        changed = FALSE;
+        for (k = n - 1; k >= 0; k--)
+        {
+            int b = porder[k], d = -1;
+            IrBlock *blk = f->blocks[b];
+            if (blk->last->op == IrReturn)
+                d = n;
+            for (j = 0; j < blk->nsucc; j++)
+            {
+                int s = blk->succ[j]->id;
+                if (ipdom[s] < 0)
+                    continue;
+                d = d < 0 ? s : pintersect(s, d);
+            }
+            if (ipdom[b] != d)
+            {
+                ipdom[b] = d;
+                changed = TRUE;
+            }
+        }
+    }
+    return TRUE;
+}
+
+static char *blockLive = NULL;
+static char *cdep = NULL; /* cdep[b*n+y]: b is control dependent on y */
+static Site *liveWork = NULL;
+static int nlive = 0;
+
+static void markLive(IrInstr *i, IrBlock *b)
+{
+    if (i == NULL || i->mark)
+        return;
+    i->mark = TRUE;
+    liveWork[nlive].instr = i;
+    liveWork[nlive].block = b;
+    nlive++;
+}
+
+static void markOperand(IrOperand o)
+{
+    if (o.kind == OpdTemp)
+        markLive(defSite[o.val].instr, defSite[o.val].block);
+}
+
+/* Function adce marks the instructions with side
+ * effects live, then whatever they use and the
+ * branches their blocks are control dependent on;
+ * everything else is removed, and dead branches
+ * jump to their nearest live postdominator. When
+ * some block cannot reach a return the branches
+ * are all kept.
+ */
+int adce(IrFunc *f)
+{
+    int n = f->nblocks, k, j, total = 0;
+    int before = irCountFuncInstrs(f);
+    int exact = postDominators(f);
+    buildDefUse(f);
+    for (k = 0; k < n; k++)
+    {
+        IrInstr *i;
+        for (i = f->blocks[k]->first; i != NULL; i = i->next)
+        {
+            i->mark = FALSE;
+            total++;
+        }
+    }
+    liveWork = realloc(liveWork, (total + 1) * sizeof(Site));
+    blockLive = realloc(blockLive, n + 1);
+    memset(blockLive, 0, n + 1);
+    cdep = realloc(cdep, n * n + 1);
+    memset(cdep, 0, n * n + 1);
+    nlive = 0;
+    if (exact)
+        for (k = 0; k < n; k++)
+        {
+            IrBlock *y = f->blocks[k];
+            if (y->nsucc < 2)
+                continue;
+            for (j = 0; j < y->nsucc; j++)
+            {
+                int r = y->succ[j]->id;
+                while (r != ipdom[k])
+                {
+                    cdep[r * n + k] = TRUE;
+                    r = ipdom[r];
+                }
+            }
+        }
+    for (k = 0; k < n; k++)
+    {
+        IrInstr *i;
+        for (i = f->blocks[k]->first; i != NULL; i = i->next)
+            if (irHasSideEffects(i) && !(exact && (i->op == IrBranch || i->op == IrJump)))
+                markLive(i, f->blocks[k]);
+    }
+    while (nlive > 0)
+    {
+        IrInstr *i = liveWork[--nlive].instr;
+        IrBlock *b = liveWork[nlive].block;
+        blockLive[b->id] = TRUE;
+        for (k = 0; k < n; k++)
+            if (cdep[b->id * n + k])
+                markLive(f->blocks[k]->last, f->blocks[k]);
+        markOperand(i->a);
+        markOperand(i->b);
+        for (j = 0; j < i->nargs; j++)
+            markOperand(i->args[j]);
+        if (i->op == IrPhi)
+            for (j = 0; j < b->npred; j++)
+                markLive(b->pred[j]->last, b->pred[j]);
+    }
+    for (k = 0; k < n; k++)
+    {
+        IrBlock *b = f->blocks[k];
+        IrInstr *i, *next;
+        for (i = b->first; i != NULL; i = next)
+        {
+            next = i->next;
+            if (i->mark || i->op == IrJump || i->op == IrReturn)
+                continue;
+            if (i->op == IrBranch)
+            {
+                int r = ipdom[k];
+                while (r != n && !blockLive[r])
+                    r = ipdom[r];
+                i->op = IrJump;
+                i->a = i->b = irNone();
+                irSetSuccs(b, f->blocks[r], NULL);
+                continue;
+            }
+            irRemove(b, i);
+        }
+    }
+    irBuildCFG(f);
+    return before - irCountFuncInstrs(f);
+}
+
+/**************************************************/
+/***********   out of SSA                ***********/
+/**************************************************/
+
+/* Procedure splitEdge puts a new block on the
+ * edge from b to its k-th successor
+ */
+static void splitEdge(IrFunc *f, IrBlock *b, int k)
+{
+    IrBlock *s = b->succ[k];
+    IrBlock *m = irNewBlock(f);
+    int j = predIndex(s, b, k > 0 && b->succ[0] == s);
+    irAppend(m, irNewInstr(IrJump, irNone(), irNone(), irNone()));
+    irSetSuccs(m, s, NULL);
+    b->succ[k] = m;
+    s->pred[j] = m;
+    m->pred = (IrBlock **)malloc(sizeof(IrBlock *));
+    m->pred[0] = b;
+    m->npred = m->maxpred = 1;
+}
+
+/* Procedure emitCopies sequentializes the
+ * parallel copies dst[k] = src[k] before the
+ * terminator of b, using a new temporary to
+ * break cycles
+ */
+static void emitCopies(IrFunc *f, IrBlock *b, int *dst, IrOperand *src, int n)
+{
+    int k, j;
+    while (n > 0)
+    {
+        for (k = 0; k < n; k++)
+        {
+            for (j = 0; j < n; j++)
+                if (src[j].kind == OpdTemp && src[j].val == dst[k])
+                    break;
+            if (j == n)
+                break;
+        }
+        if (k == n)
+        {
+            /* every destination is still to be read: save one */
+            int t = irNewTemp(f);
+            int d = dst[0];
+            irInsertBefore(b, b->last,
+                           irNewInstr(IrMov, irTemp(t), irTemp(d), irNone()));
+            for (j = 0; j < n; j++)
+                if (src[j].kind == OpdTemp && src[j].val == d)
+                    src[j] = irTemp(t);
+            k = 0;
+        }
+        irInsertBefore(b, b->last, irNewInstr(IrMov, irTemp(dst[k]), src[k], irNone()));
+        dst[k] = dst[n - 1];
+        src[k] = src[n - 1];
+        n--;
+    }
+}
+
+/* Procedure coalesceCopies removes the copies
+ * x = y where y is only read by the copy and was
+ * computed earlier in the same block with x
+ * untouched since: the computation writes x
+ * directly. This undoes most of the copies that
+ * replace the phis of loop variables
+ */
+static void coalesceCopies(IrFunc *f)
+{
+    int *uses = (int *)calloc(f->ntemps + 1, sizeof(int));
+    int k, j, n, *u = NULL, room = 0;
+    for (k = 0; k < f->nblocks; k++)
+    {
+        IrInstr *i;
+        for (i = f->blocks[k]->first; i != NULL; i = i->next)
+        {
+            if (i->nargs + 2 > room)
+            {
+                room = i->nargs + 2;
+                u = realloc(u, room * sizeof(int));
+            }
+            n = irUses(i, u);
+            for (j = 0; j < n; j++)
+                uses[u[j]]++;
+        }
+    }
+    for (k = 0; k < f->nblocks; k++)
+    {
+        IrBlock *b = f->blocks[k];
+        IrInstr *c, *d, *next;
+        for (c = b->first; c != NULL; c = next)
+        {
+            int x = c->dst.val, y = c->a.val;
+            next = c->next;
+            if (c->op != IrMov || c->a.kind != OpdTemp || x == y || uses[y] != 1)
+                continue;
+            for (d = c->prev; d != NULL && irDef(d) != y; d = d->prev)
+            {
+                if (d->nargs + 2 > room)
+                {
+                    room = d->nargs + 2;
+                    u = realloc(u, room * sizeof(int));
+                }
+                n = irUses(d, u);
+                for (j = 0; j < n && u[j] != x; j++)
+                    ;
+                if (j < n || irDef(d) == x)
+                    break;
+            }
+            if (d == NULL || irDef(d) != y)
+                continue;
+            d->dst = c->dst;
+            irRemove(b, c);
+        }
+    }
+    free(uses);
+    free(u);
+}
+
+void fromSSA(IrFunc *f)
+{
+    int k, j, nb = f->nblocks;
+    int *dst = NULL, *map;
+    IrOperand *src = NULL;
+    int room = 0, t, next;
+    for (k = 0; k < nb; k++)
+    {
+        IrBlock *b = f->blocks[k];
+        if (b->nsucc < 2)
+            continue;
+        for (j = 0; j < 2; j++)
+        {
+            IrBlock *s = b->succ[j];
+            if (s->npred > 1 && s->first != NULL && s->first->op == IrPhi)
+                splitEdge(f, b, j);
+        }
+    }
+    for (k = 0; k < nb; k++)
+    {
+        IrBlock *s = f->blocks[k];
+        int nphi = 0;
+        IrInstr *i;
+        for (i = s->first; i != NULL && i->op == IrPhi; i = i->next)
+            nphi++;
+        if (nphi == 0)
+            continue;
+        if (nphi > room)
+        {
+            room = nphi;
+            dst = realloc(dst, room * sizeof(int));
+            src = realloc(src, room * sizeof(IrOperand));
+        }
+        for (j = 0; j < s->npred; j++)
+        {
+            int n = 0;
+            for (i = s->first; i != NULL && i->op == IrPhi; i = i->next)
+                if (!(i->args[j].kind == OpdTemp && i->args[j].val == i->dst.val))
+                {
+                    dst[n] = i->dst.val;
+                    src[n++] = i->args[j];
+                }
+            emitCopies(f, s->pred[j], dst, src, n);
+        }
+        while (s->first != NULL && s->first->op == IrPhi)
+            irRemove(s, s->first);
+    }
+    irBuildCFG(f);
+    coalesceCopies(f);
+    /* renumber the temporaries still in use */
+    map = (int *)malloc((f->ntemps + 1) * sizeof(int));
+    for (t = 0; t < f->ntemps; t++)
+        map[t] = t < f->nparams ? t : -1;
+    next = f->nparams;
+    for (k = 0; k < f->nblocks; k++)
+    {
+        IrInstr *i;
+        for (i = f->blocks[k]->first; i != NULL; i = i->next)
+        {
+            IrOperand *o[3];
+            int m;
+            o[0] = &i->dst;
+            o[1] = &i->a;
+            o[2] = &i->b;
+            for (m = 0; m < 3 + i->nargs; m++)
+            {
+                IrOperand *p = m < 3 ? o[m] : &i->args[m - 3];
+                if (p->kind != OpdTemp)
+                    continue;
+                if (map[p->val] < 0)
+                    map[p->val] = next++;
+                p->val = map[p->val];
+            }
+        }
+    }
+    f->ntemps = next;
+    free(map);
+    free(dst);
+    free(src);
+}
@@ -0,0 +1,57 @@
+/****************************************************/
+/* File: ssa.h                                      */
+/* SSA construction, sparse conditional constant    */
+/* propagation and dead-code elimination on the IR  */
+/****************************************************/
+
+#ifndef _SSA_H_
+#define _SSA_H_
+
+#include "ir.h"
+
+/* Procedure computeDominators sets the idom,
+ * domDepth and rpo fields of every block of f
+ */
+void computeDominators(IrFunc *f);
+
+/* Function dominates returns TRUE if block a
+ * dominates block b
+ */
+int dominates(IrBlock *a, IrBlock *b);
+
+/* Procedure toSSA puts f in SSA form: phis are
+ * placed on the iterated dominance frontiers of
+ * the definitions and every definition gets a
+ * temporary of its own
+ */
+void toSSA(IrFunc *f);
+
+/* Function sccp runs sparse conditional constant
+ * propagation on f (in SSA form), replaces the
+ * constant temporaries by their values and folds
+ * the branches it proved one-way; it returns the
+ * number of instructions removed
+ */
+int sccp(IrFunc *f);
+
+/* Function copyProp replaces the uses of the
+ * temporaries defined by copies with the copied
+ * value (f in SSA form); it returns the number of
+ * copies removed
+ */
+int copyProp(IrFunc *f);
+
+/* Function adce removes the instructions of f (in
+ * SSA form) that do not contribute to a side
+ * effect, including branches nothing depends on;
+ * it returns the number of instructions removed
+ */
+int adce(IrFunc *f);
+
+/* Procedure fromSSA replaces the phis of f by
+ * copies on the incoming edges and renumbers
+ * the temporaries densely
+ */
+void fromSSA(IrFunc *f);
+
+#endif
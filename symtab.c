@@ -58,6 +58,11 @@ typedef struct BucketListRec
     LineList lines; // 行号列表 
     int memloc; /* memory location for variable */
     BucketType type;
+    int hasSignature; /* functions only: signature known */
+    int rettype;
+    int nparams;
+    const unsigned char *ptypes;
+    int imported; /* declared by an imported interface */
     struct BucketListRec *next;
 } * BucketList;
 
@@ -86,6 +91,8 @@ void st_insert(char *name, int lineno, int loc, BucketType type)
         l->lines->next = NULL;
         l->next = hashTable[h];
         l->type = type;
+        l->hasSignature = 0;
+        l->imported = 0;
         hashTable[h] = l;
     }
     else /* found in table, so just add line number */
@@ -115,6 +122,59 @@ int st_lookup(char *name)
         return l->memloc;
 }
 
+static BucketList st_find(char *name)
+{
+    BucketList l = hashTable[hash(name)];
+    while ((l != NULL) && (strcmp(name, l->name) != 0))
+        l = l->next;
+    return l;
+}
+
+/* Procedure st_set_signature records the return
+ * type and parameter types of function name
+ */
+void st_set_signature(char *name, int rettype, int nparams,
+                      const unsigned char *ptypes, int imported)
+{
+    BucketList l = st_find(name);
+    if (l == NULL)
+        return;
+    l->hasSignature = 1;
+    l->rettype = rettype;
+    l->nparams = nparams;
+    l->ptypes = ptypes;
+    l->imported = imported;
+}
+
+/* Function st_signature looks up the signature of
+ * function name; it returns 0 if name is not
+ * a function with a known signature
+ */
+int st_signature(char *name, int *rettype, int *nparams,
+                 const unsigned char **ptypes)
+{
+    BucketList l = st_find(name);
+    if (l == NULL || l->type != FUNC || !l->hasSignature)
+        return 0;
+    *rettype = l->rettype;
+    *nparams = l->nparams;
+    *ptypes = l->ptypes;
+    return 1;
+}
+
+void st_set_imported(char *name)
+{
+    BucketList l = st_find(name);
+    if (l != NULL)
+        l->imported = 1;
+}
+
+int st_imported(char *name)
+{
+    BucketList l = st_find(name);
+    return l != NULL && l->imported;
+}
+
 /* Procedure printSymTab prints a formatted
  * listing of the symbol table contents
  * to the listing file
@@ -133,7 +193,9 @@ void printSymTab(FILE *listing)
             {
                 LineList t = l->lines;
                 fprintf(listing, "%-14s ", l->name);
-                if (l->type == VAR) {
+                if (l->imported) {
+                    fprintf(listing, "%-12s", "imported");
+                } else if (l->type == VAR) {
                     fprintf(listing, "%-12s", "variable");
                 } else if (l->type == FUNC) {
                     fprintf(listing, "%-12s", "function");
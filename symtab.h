@@ -26,6 +26,32 @@ void st_insert( char * name, int lineno, int loc, BucketType type);
  */
 int st_lookup ( char * name );
 
+/* Procedure st_set_signature records the return
+ * type and parameter types of function name;
+ * ptypes is kept by reference, not copied, so an
+ * interface file mapped into memory can be used
+ * directly
+ */
+void st_set_signature( char * name, int rettype, int nparams,
+                       const unsigned char * ptypes, int imported );
+
+/* Function st_signature looks up the signature of
+ * function name; it returns FALSE if name is not
+ * a function with a known signature
+ */
+int st_signature( char * name, int * rettype, int * nparams,
+                  const unsigned char ** ptypes );
+
+/* Procedure st_set_imported marks name as
+ * declared by an imported interface
+ */
+void st_set_imported( char * name );
+
+/* Function st_imported returns TRUE if name
+ * was declared by an imported interface
+ */
+int st_imported( char * name );
+
 /* Procedure printSymTab prints a formatted 
  * listing of the symbol table contents 
  * to the listing file
@@ -0,0 +1,89 @@
+/****************************************************/
+/* File: tail.c                                     */
+/* Tail-call elimination in the IR for the C--      */
+/* compiler                                         */
+/****************************************************/
+
+#include "globals.h"
+#include "ir.h"
+#include "tail.h"
+
+int isTailCall(IrInstr *i)
+{
+    IrInstr *r = i->next;
+    if (i->op != IrCall || r == NULL || r->op != IrReturn)
+        return FALSE;
+    return r->a.kind == OpdNone ||
+           (r->a.kind == OpdTemp && i->dst.kind == OpdTemp && r->a.val == i->dst.val);
+}
+
+/* Procedure loopBack replaces the self call i and
+ * the return after it, which end block b, by a
+ * jump to body; the arguments go through new
+ * temporaries since they may read the parameters
+ */
+static void loopBack(IrFunc *f, IrBlock *b, IrInstr *i, IrBlock *body)
+{
+    int *tmp = (int *)malloc((i->nargs + 1) * sizeof(int));
+    IrInstr *j;
+    int k;
+    irRemove(b, i->next);
+    irRemove(b, i);
+    for (k = 0; k < i->nargs; k++)
+    {
+        tmp[k] = irNewTemp(f);
+        j = irNewInstr(IrMov, irTemp(tmp[k]), i->args[k], irNone());
+        j->lineno = i->lineno;
+        irAppend(b, j);
+    }
+    for (k = 0; k < i->nargs; k++)
+    {
+        j = irNewInstr(IrMov, irTemp(k), irTemp(tmp[k]), irNone());
+        j->lineno = i->lineno;
+        irAppend(b, j);
+    }
+    j = irNewInstr(IrJump, irNone(), irNone(), irNone());
+    j->lineno = i->lineno;
+    irAppend(b, j);
+    irSetSuccs(b, body, NULL);
+    free(tmp);
+}
+
+int eliminateTailCalls(IrProgram *p)
+{
+    IrFunc *f;
+    int n = 0;
+    if (TraceOpt)
+        fprintf(listing, "\nTail calls:\n");
+    for (f = p->funcs; f != NULL; f = f->next)
+    {
+        IrBlock *body = f->blocks[0];
+        int k, m = 0;
+        for (k = 0; k < f->nblocks; k++)
+        {
+            IrBlock *b = f->blocks[k];
+            IrInstr *i;
+            for (i = b->first; i != NULL; i = i->next)
+                if (isTailCall(i) && strcmp(i->callee, f->name) == 0)
+                    break;
+            if (i == NULL)
+                continue;
+            if (TraceOpt)
+                fprintf(listing, "%s: tail call at line %d turned into a jump\n",
+                        f->name, i->lineno);
+            if (m++ == 0)
+            {
+                /* the parameters are loaded on entry: loop below that */
+                IrBlock *entry = irNewBlockAt(f, 0);
+                irAppend(entry, irNewInstr(IrJump, irNone(), irNone(), irNone()));
+                irSetSuccs(entry, body, NULL);
+                k++;
+            }
+            loopBack(f, b, i, body);
+        }
+        if (m > 0)
+            irBuildCFG(f);
+        n += m;
+    }
+    return n;
+}
@@ -0,0 +1,27 @@
+/****************************************************/
+/* File: tail.h                                     */
+/* Tail-call elimination in the IR for the C--      */
+/* compiler                                         */
+/****************************************************/
+
+#ifndef _TAIL_H_
+#define _TAIL_H_
+
+#include "ir.h"
+
+/* Function isTailCall returns TRUE if the call i
+ * is followed by a return of its result (or a
+ * return without value), so the callee can
+ * return straight to the caller's caller
+ */
+int isTailCall(IrInstr *i);
+
+/* Function eliminateTailCalls turns the calls a
+ * function makes to itself in tail position into
+ * copies of the arguments to its parameters and
+ * a jump back to its first block; it returns the
+ * number of calls removed
+ */
+int eliminateTailCalls(IrProgram *p);
+
+#endif
@@ -0,0 +1,120 @@
+#!/bin/sh
+# File: tests/run.sh
+# Runs every tests/NAME.tny under each compiler
+# configuration: NAME.in holds the input, one value per
+# line, and NAME.out the values the program must write;
+# NAME.err instead holds text the listing must contain
+# because the program must not compile; then tiny must
+# fail and write no code file. A program in several
+# modules lists the others, which are in tests/modules,
+# in NAME.mods; they are compiled with -c and linked by
+# tmlink in that order, the program last.
+# Usage: sh tests/run.sh (from the directory of tiny)
+
+top=$(pwd)
+tests="$top/tests"
+work=$(mktemp -d)
+trap 'rm -rf "$work"' EXIT
+pass=0
+fail=0
+
+# Procedure check compiles and runs test $1 with the
+# compiler configuration $2 (the command line of tiny,
+# without the source file)
+check()
+{
+    name=$1
+    config=$2
+    rm -f "$work"/*
+    cp "$tests/$name.tny" "$work/$name.tny"
+    if [ -f "$tests/$name.mods" ]; then
+        link "$name" "$config"
+        return
+    fi
+    (cd "$work" && $config "$name.tny" > listing 2>&1)
+    status=$?
+    if [ -f "$tests/$name.err" ]; then
+        rejected "$name" "$config" $status "$name.tm"
+        return
+    fi
+    execute "$name" "$config" "$name.tm"
+}
+
+# Procedure rejected checks that compiling test $1 with
+# configuration $2 reported the expected error, ended
+# with the nonzero status $3 and wrote no code file $4
+rejected()
+{
+    if ! grep -q -F -f "$tests/$1.err" "$work/listing"; then
+        echo "FAIL $1 ($2): expected error not reported"
+        fail=$((fail + 1))
+    elif [ $3 -eq 0 ] || [ -f "$work/$4" ]; then
+        echo "FAIL $1 ($2): error but exit status 0 or code written"
+        fail=$((fail + 1))
+    else
+        pass=$((pass + 1))
+    fi
+}
+
+# Procedure link compiles the modules of test $1 and the
+# program with configuration $2, links them and runs them
+link()
+{
+    name=$1
+    config=$2
+    objects=
+    for mod in $(cat "$tests/$name.mods"); do
+        cp "$tests/modules/$mod.tny" "$work/$mod.tny"
+        (cd "$work" && $config -i -c "$mod.tny" > listing 2>&1)
+        objects="$objects $mod.tmo"
+    done
+    (cd "$work" && $config -c "$name.tny" *.cmi > listing 2>&1)
+    status=$?
+    if [ -f "$tests/$name.err" ]; then
+        rejected "$name" "$config" $status "$name.tmo"
+        return
+    fi
+    (cd "$work" && [ $status -eq 0 ] &&
+        "$top/tmlink" -o "$name.tmb" $objects "$name.tmo" > link 2>&1)
+    if [ $? -ne 0 ]; then
+        echo "FAIL $name ($config): not linked:" $(cat "$work/link" 2>/dev/null)
+        fail=$((fail + 1))
+        return
+    fi
+    execute "$name" "$config" "$name.tmb"
+}
+
+# Procedure execute runs program $3 of test $1 under tm
+# and compares what it writes with the expected output
+execute()
+{
+    name=$1
+    config=$2
+    if [ ! -f "$work/$3" ]; then
+        echo "FAIL $name ($config): no code generated"
+        fail=$((fail + 1))
+        return
+    fi
+    input=/dev/null
+    [ -f "$tests/$name.in" ] && input="$tests/$name.in"
+    (echo g; cat "$input"; echo q) | (cd "$work" && timeout 10 "$top/tm" "$3") > "$work/run" 2>&1
+    sed -n 's/.*OUT instruction prints: *//p' "$work/run" > "$work/got"
+    if ! grep -q Halted "$work/run"; then
+        echo "FAIL $name ($config): did not halt"
+        fail=$((fail + 1))
+    elif ! cmp -s "$work/got" "$tests/$name.out"; then
+        echo "FAIL $name ($config): wrote" $(cat "$work/got") "expected" $(cat "$tests/$name.out")
+        fail=$((fail + 1))
+    else
+        pass=$((pass + 1))
+    fi
+}
+
+for config in "$top/tiny -O0" "$top/tiny -O1" "$top/tiny -O2" "$top/tiny -O2 -j4" "$top/tiny_direct"; do
+    for src in "$tests"/*.tny; do
+        check "$(basename "$src" .tny)" "$config"
+    done
+done
+
+echo "$pass passed, $fail failed"
+[ "$fail" -eq 0 ]
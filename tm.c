@@ -10,6 +10,8 @@
 #include <string.h>
 #include <ctype.h>
 
+#include "tmfmt.h"
+
 #ifndef TRUE
 #define TRUE 1
 #endif
@@ -70,12 +72,7 @@ typedef enum {
    srZERODIVIDE
    } STEPRESULT;
 
-typedef struct {
-      int iop  ;
-      int iarg1  ;
-      int iarg2  ;
-      int iarg3  ;
-   } INSTRUCTION;
+typedef TmbInstr INSTRUCTION; /* iop, iarg1, iarg2, iarg3 */
 
 /******** vars ********/
 int iloc = 0 ;
@@ -102,6 +99,8 @@ char * stepResultTab[]
 
 char pgmName[20];
 FILE *pgm  ;
+TmbImage image ; /* the program, when loaded from a .tmb file */
+int binaryPgm = FALSE;
 
 char in_Line[LINESIZE] ;
 int lineLen ;
@@ -303,6 +302,43 @@ int readInstructions (void)
 } /* readInstructions */
 
 
+/********************************************/
+void loadData (void)
+{ if (binaryPgm)
+    memcpy(dMem + image.header->dataBase, image.data,
+           image.header->ndata * sizeof(int)) ;
+} /* loadData */
+
+/********************************************/
+int loadBinary (void)
+{ int loc, regNo;
+  if (! tmbLoad(pgmName, &image))
+    return FALSE;
+  if (image.header->kind != TMB_PROGRAM)
+  { printf("file '%s': object file, link it with tmlink first\n",pgmName);
+    return FALSE; }
+  if (image.header->ninstr > IADDR_SIZE)
+  { printf("file '%s': program too large\n",pgmName);
+    return FALSE; }
+  if (image.header->dataBase + image.header->ndata > DADDR_SIZE)
+  { printf("file '%s': data too large\n",pgmName);
+    return FALSE; }
+  for (regNo = 0 ; regNo < NO_REGS ; regNo++)
+      reg[regNo] = 0 ;
+  dMem[0] = DADDR_SIZE - 1 ;
+  for (loc = 1 ; loc < DADDR_SIZE ; loc++)
+      dMem[loc] = 0 ;
+  loadData();
+  memcpy(iMem, image.instr, image.header->ninstr * sizeof(INSTRUCTION)) ;
+  for (loc = image.header->ninstr ; loc < IADDR_SIZE ; loc++)
+  { iMem[loc].iop = opHALT ;
+    iMem[loc].iarg1 = 0 ;
+    iMem[loc].iarg2 = 0 ;
+    iMem[loc].iarg3 = 0 ;
+  }
+  return TRUE;
+} /* loadBinary */
+
 /********************************************/
 STEPRESULT stepTM (void)
 { INSTRUCTION currentinstruction  ;
@@ -520,6 +556,7 @@ int doCommand (void)
       dMem[0] = DADDR_SIZE - 1 ;
       for (loc = 1 ; loc < DADDR_SIZE ; loc++)
             dMem[loc] = 0 ;
+      loadData();
       break;
 
     case 'q' : return FALSE;  /* break; */
@@ -565,15 +602,25 @@ main( int argc, char * argv[] )
   strcpy(pgmName,argv[1]) ;
   if (strchr (pgmName, '.') == NULL)
      strcat(pgmName,".tm");
-  pgm = fopen(pgmName,"r");
-  if (pgm == NULL)
-  { printf("file '%s' not found\n",pgmName);
-    exit(1);
+  binaryPgm = strlen(pgmName) > 4
+           && (strcmp(pgmName + strlen(pgmName) - 4, ".tmb") == 0
+               || strcmp(pgmName + strlen(pgmName) - 4, ".tmo") == 0) ;
+  if (binaryPgm)
+  { /* map the program */
+    if ( ! loadBinary ())
+         exit(1) ;
   }
+  else
+  { pgm = fopen(pgmName,"r");
+    if (pgm == NULL)
+    { printf("file '%s' not found\n",pgmName);
+      exit(1);
+    }
 
-  /* read the program */
-  if ( ! readInstructions ())
+    /* read the program */
+    if ( ! readInstructions ())
          exit(1) ;
+  }
   /* switch input file to terminal */
   /* reset( input ); */
   /* read-eval-print */
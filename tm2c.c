@@ -0,0 +1,683 @@
+/****************************************************/
+/* File: tm2c.c                                     */
+/* Translator of TM programs (.tm or .tmb) into     */
+/* standalone C                                     */
+/****************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "tmfmt.h"
+
+#ifndef TRUE
+#define TRUE 1
+#endif
+#ifndef FALSE
+#define FALSE 0
+#endif
+
+/* as in tm.c */
+#define IADDR_SIZE 1024
+#define DADDR_SIZE 1024
+#define NO_REGS 8
+#define PC_REG 7
+
+#define LINESIZE 121
+#define WORDSIZE 20
+
+/* the opcodes, numbered as in tm.c */
+enum
+{
+    opHALT, opIN, opOUT, opADD, opSUB, opMUL, opDIV, opRRLim,
+    opLD, opST, opRMLim,
+    opLDA, opLDC, opJLT, opJLE, opJGT, opJGE, opJEQ, opJNE, opRALim
+};
+
+static char *opCodeTab[] = {"HALT", "IN", "OUT", "ADD", "SUB", "MUL", "DIV", "????",
+                            "LD", "ST", "????",
+                            "LDA", "LDC", "JLT", "JLE", "JGT", "JGE", "JEQ", "JNE", "????"};
+
+/* the conditions of the jumps, from opJLT on */
+static char *jumpTab[] = {"<", "<=", ">", ">=", "==", "!="};
+
+/* the program; readInstructions in tm.c accepts
+ * location IADDR_SIZE too, so there is room for it
+ */
+static TmbInstr iMem[IADDR_SIZE + 1];
+static int ninstr = 0; /* locations 0 .. ninstr-1 are translated */
+static TmbImage image;
+static int binaryPgm = FALSE;
+
+static int countSteps = FALSE; /* -p: print the instructions executed */
+
+static FILE *pgm;
+static FILE *out;
+
+/* the scanner of readInstructions */
+static char in_Line[LINESIZE];
+static int lineLen;
+static int inCol;
+static int num;
+static char word[WORDSIZE];
+static char ch;
+
+static int opClass(int c)
+{
+    if (c <= opRRLim)
+        return opRRLim;
+    else if (c <= opRMLim)
+        return opRMLim;
+    else
+        return opRALim;
+}
+
+static void getCh(void)
+{
+    if (++inCol < lineLen)
+        ch = in_Line[inCol];
+    else
+        ch = ' ';
+}
+
+static int nonBlank(void)
+{
+    while (inCol < lineLen && in_Line[inCol] == ' ')
+        inCol++;
+    if (inCol < lineLen)
+    {
+        ch = in_Line[inCol];
+        return TRUE;
+    }
+    ch = ' ';
+    return FALSE;
+}
+
+static int getNum(void)
+{
+    int sign, term, temp = FALSE;
+    num = 0;
+    do
+    {
+        sign = 1;
+        while (nonBlank() && (ch == '+' || ch == '-'))
+        {
+            temp = FALSE;
+            if (ch == '-')
+                sign = -sign;
+            getCh();
+        }
+        term = 0;
+        nonBlank();
+        while (isdigit(ch))
+        {
+            temp = TRUE;
+            term = term * 10 + (ch - '0');
+            getCh();
+        }
+        num = num + term * sign;
+    } while (nonBlank() && (ch == '+' || ch == '-'));
+    return temp;
+}
+
+static int getWord(void)
+{
+    int length = 0;
+    if (!nonBlank())
+        return FALSE;
+    while (isalnum(ch))
+    {
+        if (length < WORDSIZE - 1)
+            word[length++] = ch;
+        getCh();
+    }
+    word[length] = '\0';
+    return length != 0;
+}
+
+static int skipCh(char c)
+{
+    if (nonBlank() && ch == c)
+    {
+        getCh();
+        return TRUE;
+    }
+    return FALSE;
+}
+
+static int error(char *msg, int lineNo, int instNo)
+{
+    printf("Line %d", lineNo);
+    if (instNo >= 0)
+        printf(" (Instruction %d)", instNo);
+    printf("   %s\n", msg);
+    return FALSE;
+}
+
+/* Function getReg reads a register number into num
+ * and returns FALSE if there is none
+ */
+static int getReg(void)
+{
+    return getNum() && num >= 0 && num < NO_REGS;
+}
+
+/* Function readInstructions reads a text program
+ * as tm.c's readInstructions does, and returns
+ * FALSE after a message if it is malformed
+ */
+static int readInstructions(void)
+{
+    int op, arg1, arg2, arg3, loc, lineNo = 0;
+    while (fgets(in_Line, LINESIZE - 2, pgm) != NULL)
+    {
+        inCol = 0;
+        lineNo++;
+        lineLen = strlen(in_Line);
+        if (lineLen > 0 && in_Line[lineLen - 1] == '\n')
+            in_Line[--lineLen] = '\0';
+        if (!nonBlank() || in_Line[inCol] == '*')
+            continue;
+        if (!getNum() || num < 0)
+            return error("Bad location", lineNo, -1);
+        loc = num;
+        if (loc > IADDR_SIZE)
+            return error("Location too large", lineNo, loc);
+        if (!skipCh(':'))
+            return error("Missing colon", lineNo, loc);
+        if (!getWord())
+            return error("Missing opcode", lineNo, loc);
+        op = opHALT;
+        while (op < opRALim && strncmp(opCodeTab[op], word, 4) != 0)
+            op++;
+        if (strncmp(opCodeTab[op], word, 4) != 0)
+            return error("Illegal opcode", lineNo, loc);
+        if (!getReg())
+            return error("Bad first register", lineNo, loc);
+        arg1 = num;
+        if (!skipCh(','))
+            return error("Missing comma", lineNo, loc);
+        if (opClass(op) == opRRLim)
+        {
+            if (!getReg())
+                return error("Bad second register", lineNo, loc);
+            arg2 = num;
+            if (!skipCh(','))
+                return error("Missing comma", lineNo, loc);
+            if (!getReg())
+                return error("Bad third register", lineNo, loc);
+            arg3 = num;
+        }
+        else
+        {
+            if (!getNum())
+                return error("Bad displacement", lineNo, loc);
+            arg2 = num;
+            if (!skipCh('(') && !skipCh(','))
+                return error("Missing LParen", lineNo, loc);
+            if (!getReg())
+                return error("Bad second register", lineNo, loc);
+            arg3 = num;
+        }
+        iMem[loc].iop = op;
+        iMem[loc].iarg1 = arg1;
+        iMem[loc].iarg2 = arg2;
+        iMem[loc].iarg3 = arg3;
+        if (loc >= ninstr)
+            ninstr = loc + 1;
+    }
+    return TRUE;
+}
+
+/* Function loadBinary loads a .tmb program as
+ * tm.c's loadBinary does
+ */
+static int loadBinary(char *name)
+{
+    TmbHeader *h;
+    int loc, bad;
+    if (!tmbLoad(name, &image))
+        return FALSE;
+    h = image.header;
+    if (h->kind != TMB_PROGRAM)
+    {
+        printf("file '%s': object file, link it with tmlink first\n", name);
+        return FALSE;
+    }
+    if (h->ninstr > IADDR_SIZE)
+    {
+        printf("file '%s': program too large\n", name);
+        return FALSE;
+    }
+    if (h->dataBase + h->ndata > DADDR_SIZE)
+    {
+        printf("file '%s': data too large\n", name);
+        return FALSE;
+    }
+    for (loc = 0; loc < h->ninstr; loc++)
+    {
+        TmbInstr *i = &image.instr[loc];
+        bad = i->iarg1 < 0 || i->iarg1 >= NO_REGS;
+        if (opClass(i->iop) == opRRLim)
+            bad = bad || i->iarg2 < 0 || i->iarg2 >= NO_REGS;
+        bad = bad || i->iarg3 < 0 || i->iarg3 >= NO_REGS;
+        if (bad)
+        {
+            printf("file '%s': bad register at location %d\n", name, loc);
+            return FALSE;
+        }
+    }
+    memcpy(iMem, image.instr, h->ninstr * sizeof(TmbInstr));
+    ninstr = h->ninstr;
+    return TRUE;
+}
+
+/***************************************************/
+/* the translation                                 */
+/***************************************************/
+
+/* Procedure putReg writes the value of register r
+ * as read by the instruction at loc: pc has been
+ * stepped past it, so reg 7 is the constant loc+1
+ */
+static void putReg(int r, int loc)
+{
+    if (r == PC_REG)
+        fprintf(out, "%d", loc + 1);
+    else
+        fprintf(out, "r%d", r);
+}
+
+/* Procedure putJump writes the transfer of control
+ * to the constant location target
+ */
+static void putJump(int target)
+{
+    if (target < 0 || target > IADDR_SIZE)
+        fprintf(out, "goto imemFault;");
+    else if (target >= ninstr)
+        fprintf(out, "goto halt;");
+    else
+        fprintf(out, "goto L%d;", target);
+}
+
+/* Function putAddress writes m = d+reg(s) for the
+ * instruction at loc, unless s is the pc and the
+ * address a constant; it returns whether it was
+ */
+static int putAddress(TmbInstr *i, int loc)
+{
+    if (i->iarg3 == PC_REG)
+        return TRUE;
+    fprintf(out, "\tm = WRAP(%d, ", i->iarg2);
+    putReg(i->iarg3, loc);
+    fprintf(out, ");\n");
+    return FALSE;
+}
+
+/* Procedures putSetStart and putSetEnd write the
+ * assignment of a value to reg(r) around it; a pc
+ * destination jumps through the dispatch
+ */
+static void putSetEnd(int r)
+{
+    if (r == PC_REG)
+        fprintf(out, ";\n\tgoto dispatch;\n");
+    else
+        fprintf(out, ";\n");
+}
+
+static void putSetStart(int r)
+{
+    if (r == PC_REG)
+        fprintf(out, "\tpc = ");
+    else
+        fprintf(out, "\tr%d = ", r);
+}
+
+/* Procedure genInstr writes the C for the
+ * instruction at loc, which stepTM would execute
+ */
+static void genInstr(int loc)
+{
+    TmbInstr *i = &iMem[loc];
+    int r = i->iarg1, s = i->iarg2, t = i->iarg3, d = i->iarg2;
+    int folded = FALSE, m = 0;
+    if (opClass(i->iop) == opRRLim || i->iop >= opRALim || i->iop < 0)
+        fprintf(out, "L%d: /* %s %d,%d,%d */\n", loc,
+                i->iop >= 0 && i->iop < opRALim ? opCodeTab[i->iop] : "????", r, s, t);
+    else
+        fprintf(out, "L%d: /* %s %d,%d(%d) */\n", loc, opCodeTab[i->iop], r, d, t);
+    if (countSteps)
+        fprintf(out, "\tsteps++;\n");
+    if (opClass(i->iop) == opRMLim)
+    {
+        /* the address is checked before anything else */
+        folded = putAddress(i, loc);
+        m = d + loc + 1;
+        if (folded && (m < 0 || m > DADDR_SIZE))
+        {
+            fprintf(out, "\treturn stop(srDMEM_ERR);\n");
+            return;
+        }
+        if (!folded)
+            fprintf(out, "\tif (m < 0 || m > DADDR_SIZE)\n\t\treturn stop(srDMEM_ERR);\n");
+    }
+    switch (i->iop)
+    {
+    case opHALT:
+        fprintf(out, "\tprintf(\"HALT: %d,%d,%d\\n\");\n", r, s, t);
+        fprintf(out, "\treturn stop(srHALT);\n");
+        break;
+    case opIN:
+        putSetStart(r);
+        fprintf(out, "readValue()");
+        putSetEnd(r);
+        break;
+    case opOUT:
+        fprintf(out, "\tprintf(\"OUT instruction prints: %%d\\n\", ");
+        putReg(r, loc);
+        fprintf(out, ");\n");
+        break;
+    case opADD:
+    case opSUB:
+    case opMUL:
+        putSetStart(r);
+        fprintf(out, "WRAP%s(", i->iop == opADD ? "" : i->iop == opSUB ? "SUB" : "MUL");
+        putReg(s, loc);
+        fprintf(out, ", ");
+        putReg(t, loc);
+        fprintf(out, ")");
+        putSetEnd(r);
+        break;
+    case opDIV:
+        fprintf(out, "\tif (");
+        putReg(t, loc);
+        fprintf(out, " == 0)\n\t\treturn stop(srZERODIVIDE);\n");
+        putSetStart(r);
+        putReg(s, loc);
+        fprintf(out, " / ");
+        putReg(t, loc);
+        putSetEnd(r);
+        break;
+    case opLD:
+        putSetStart(r);
+        if (folded)
+            fprintf(out, "dMem[%d]", m);
+        else
+            fprintf(out, "dMem[m]");
+        putSetEnd(r);
+        break;
+    case opST:
+        if (folded)
+            fprintf(out, "\tdMem[%d] = ", m);
+        else
+            fprintf(out, "\tdMem[m] = ");
+        putReg(r, loc);
+        fprintf(out, ";\n");
+        break;
+    case opLDA:
+    case opLDC:
+        if (i->iop == opLDC)
+            m = d;
+        else if (t == PC_REG)
+            m = d + loc + 1;
+        if (r == PC_REG && (i->iop == opLDC || t == PC_REG))
+        {
+            fprintf(out, "\t");
+            putJump(m);
+            fprintf(out, "\n");
+            break;
+        }
+        putSetStart(r);
+        if (i->iop == opLDC || t == PC_REG)
+            fprintf(out, "%d", m);
+        else
+        {
+            fprintf(out, "WRAP(%d, ", d);
+            putReg(t, loc);
+            fprintf(out, ")");
+        }
+        putSetEnd(r);
+        break;
+    case opJLT:
+    case opJLE:
+    case opJGT:
+    case opJGE:
+    case opJEQ:
+    case opJNE:
+        fprintf(out, "\tif (");
+        putReg(r, loc);
+        fprintf(out, " %s 0)\n", jumpTab[i->iop - opJLT]);
+        if (t == PC_REG)
+        {
+            fprintf(out, "\t\t");
+            putJump(d + loc + 1);
+            fprintf(out, "\n");
+        }
+        else
+        {
+            fprintf(out, "\t{\n\t\tpc = WRAP(%d, ", d);
+            putReg(t, loc);
+            fprintf(out, ");\n\t\tgoto dispatch;\n\t}\n");
+        }
+        break;
+    default:
+        /* not an instruction: stepTM does nothing */
+        break;
+    }
+}
+
+/* the part of the C file that does not depend on
+ * the program
+ */
+static char *runtime[] = {
+    "#include <stdio.h>",
+    "#include <stdlib.h>",
+    "#include <string.h>",
+    "#include <ctype.h>",
+    "",
+    "#define IADDR_SIZE 1024",
+    "#define DADDR_SIZE 1024",
+    "#define LINESIZE 121",
+    "",
+    "/* arithmetic wraps around, as it does in tm */",
+    "#define WRAP(a, b) ((int)((unsigned)(a) + (unsigned)(b)))",
+    "#define WRAPSUB(a, b) ((int)((unsigned)(a) - (unsigned)(b)))",
+    "#define WRAPMUL(a, b) ((int)((unsigned)(a) * (unsigned)(b)))",
+    "",
+    "enum { srOKAY, srHALT, srIMEM_ERR, srDMEM_ERR, srZERODIVIDE };",
+    "",
+    "static char *stepResultTab[] = {\"OK\", \"Halted\", \"Instruction Memory Fault\",",
+    "                                \"Data Memory Fault\", \"Division by 0\"};",
+    "",
+    "static unsigned steps = 0;",
+    "",
+    "static char in_Line[LINESIZE];",
+    "static int lineLen, inCol, num;",
+    "static char ch;",
+    "",
+    "static void getCh(void)",
+    "{",
+    "    if (++inCol < lineLen)",
+    "        ch = in_Line[inCol];",
+    "    else",
+    "        ch = ' ';",
+    "}",
+    "",
+    "static int nonBlank(void)",
+    "{",
+    "    while (inCol < lineLen && in_Line[inCol] == ' ')",
+    "        inCol++;",
+    "    if (inCol < lineLen)",
+    "    {",
+    "        ch = in_Line[inCol];",
+    "        return 1;",
+    "    }",
+    "    ch = ' ';",
+    "    return 0;",
+    "}",
+    "",
+    "static int getNum(void)",
+    "{",
+    "    int sign, term, temp = 0;",
+    "    num = 0;",
+    "    do",
+    "    {",
+    "        sign = 1;",
+    "        while (nonBlank() && (ch == '+' || ch == '-'))",
+    "        {",
+    "            temp = 0;",
+    "            if (ch == '-')",
+    "                sign = -sign;",
+    "            getCh();",
+    "        }",
+    "        term = 0;",
+    "        nonBlank();",
+    "        while (isdigit(ch))",
+    "        {",
+    "            temp = 1;",
+    "            term = term * 10 + (ch - '0');",
+    "            getCh();",
+    "        }",
+    "        num = num + term * sign;",
+    "    } while (nonBlank() && (ch == '+' || ch == '-'));",
+    "    return temp;",
+    "}",
+    "",
+    "/* the IN instruction; tm keeps asking at the end of",
+    " * its input, the program stops there instead */",
+    "static int readValue(void)",
+    "{",
+    "    for (;;)",
+    "    {",
+    "        printf(\"Enter value for IN instruction: \");",
+    "        fflush(stdout);",
+    "        if (fgets(in_Line, LINESIZE, stdin) == NULL)",
+    "        {",
+    "            printf(\"\\nEnd of input\\n\");",
+    "            exit(1);",
+    "        }",
+    "        lineLen = strlen(in_Line);",
+    "        if (lineLen > 0 && in_Line[lineLen - 1] == '\\n')",
+    "            in_Line[--lineLen] = '\\0';",
+    "        inCol = 0;",
+    "        if (getNum())",
+    "            return num;",
+    "        printf(\"Illegal value\\n\");",
+    "    }",
+    "}",
+    "",
+    NULL};
+
+/* Procedure genProgram writes the C translation of
+ * the program read from name
+ */
+static void genProgram(char *name)
+{
+    int k, loc;
+    fprintf(out, "/* %s translated to C by tm2c */\n\n", name);
+    for (k = 0; runtime[k] != NULL; k++)
+        fprintf(out, "%s\n", runtime[k]);
+    fprintf(out, "static int dMem[DADDR_SIZE + 1] = {\n\t[0] = DADDR_SIZE - 1,\n");
+    if (binaryPgm)
+        for (k = 0; k < image.header->ndata; k++)
+            if (image.data[k] != 0 || image.header->dataBase + k == 0)
+                fprintf(out, "\t[%d] = %d,\n", image.header->dataBase + k, image.data[k]);
+    fprintf(out, "};\n\n");
+    fprintf(out, "/* Function stop ends the run with result r, as\n");
+    fprintf(out, " * tm's go command does */\n");
+    fprintf(out, "static int stop(int r)\n{\n");
+    if (countSteps)
+        fprintf(out, "    printf(\"Number of instructions executed = %%d\\n\", (int)steps);\n");
+    fprintf(out, "    printf(\"%%s\\n\", stepResultTab[r]);\n    return 0;\n}\n\n");
+    fprintf(out, "int main(void)\n{\n");
+    fprintf(out, "\tint r0 = 0, r1 = 0, r2 = 0, r3 = 0, r4 = 0, r5 = 0, r6 = 0;\n");
+    fprintf(out, "\tint pc, m;\n\n");
+    for (loc = 0; loc < ninstr; loc++)
+        genInstr(loc);
+    fprintf(out, "\t");
+    putJump(ninstr);
+    fprintf(out, "\n\n");
+    fprintf(out, "dispatch:\n");
+    fprintf(out, "\tif (pc < 0 || pc > IADDR_SIZE)\n\t\tgoto imemFault;\n");
+    fprintf(out, "\tswitch (pc)\n\t{\n");
+    for (loc = 0; loc < ninstr; loc++)
+        fprintf(out, "\tcase %d: goto L%d;\n", loc, loc);
+    fprintf(out, "\tdefault: goto halt;\n\t}\n\n");
+    fprintf(out, "halt: /* HALT 0,0,0 fills the rest of iMem */\n");
+    if (countSteps)
+        fprintf(out, "\tsteps++;\n");
+    fprintf(out, "\tprintf(\"HALT: 0,0,0\\n\");\n\treturn stop(srHALT);\n\n");
+    fprintf(out, "imemFault:\n");
+    if (countSteps)
+        fprintf(out, "\tsteps++;\n");
+    fprintf(out, "\treturn stop(srIMEM_ERR);\n}\n");
+}
+
+int main(int argc, char *argv[])
+{
+    char pgmName[FILENAME_MAX];
+    char *outfile = NULL, *name = NULL;
+    int k, len;
+    for (k = 1; k < argc; k++)
+    {
+        if (strcmp(argv[k], "-o") == 0 && k + 1 < argc)
+            outfile = argv[++k];
+        else if (strcmp(argv[k], "-p") == 0)
+            countSteps = TRUE;
+        else if (name == NULL)
+            name = argv[k];
+        else
+            name = "";
+    }
+    if (name == NULL || *name == '\0' || strlen(name) + 4 > sizeof(pgmName))
+    {
+        fprintf(stderr, "usage: %s [-p] [-o program.c] program.tm|program.tmb\n", argv[0]);
+        exit(1);
+    }
+    strcpy(pgmName, name);
+    if (strchr(pgmName, '.') == NULL)
+        strcat(pgmName, ".tm");
+    len = strlen(pgmName);
+    binaryPgm = len > 4 && (strcmp(pgmName + len - 4, ".tmb") == 0 ||
+                            strcmp(pgmName + len - 4, ".tmo") == 0);
+    if (binaryPgm)
+    {
+        if (!loadBinary(pgmName))
+            exit(1);
+    }
+    else
+    {
+        pgm = fopen(pgmName, "r");
+        if (pgm == NULL)
+        {
+            printf("file '%s' not found\n", pgmName);
+            exit(1);
+        }
+        if (!readInstructions())
+            exit(1);
+        fclose(pgm);
+    }
+    if (outfile == NULL)
+    {
+        len = strcspn(pgmName, ".");
+        outfile = calloc(len + 3, 1);
+        strncpy(outfile, pgmName, len);
+        strcat(outfile, ".c");
+    }
+    out = fopen(outfile, "w");
+    if (out == NULL)
+    {
+        printf("Unable to open %s\n", outfile);
+        exit(1);
+    }
+    genProgram(pgmName);
+    if (fclose(out) != 0)
+    {
+        printf("Unable to write %s\n", outfile);
+        exit(1);
+    }
+    return 0;
+}
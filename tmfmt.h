@@ -0,0 +1,114 @@
+/****************************************************/
+/* File: tmfmt.h                                    */
+/* The binary format of TM programs, written by the */
+/* C-- compiler (-b) and loaded by tm               */
+/****************************************************/
+
+#ifndef _TMFMT_H_
+#define _TMFMT_H_
+
+/* A .tmb file holds, in the byte order of the
+ * machine that wrote it:
+ *
+ *   TmbHeader
+ *   ninstr TmbInstr    iMem[0 .. ninstr-1]
+ *   ndata ints         dMem[dataBase .. dataBase+ndata-1]
+ *   nsyms TmbSymbol    names of code and data locations
+ *   nrelocs TmbReloc   objects only
+ *   strsize chars      the symbol names, each ending in NUL
+ *
+ * Everything but the names is a fixed-width array,
+ * so loading the file is a matter of mapping it
+ * and copying the arrays into place; a symbol
+ * holds the offset of its name in the strings,
+ * so names are as long as they need to be.
+ *
+ * A program (TMB_PROGRAM) runs in tm as it is. An
+ * object (TMB_OBJECT, a .tmo file) is one module
+ * for tmlink: its code starts at location 0 and
+ * its nglobals words of globals at 0(gp), and the
+ * relocations say what must change when the
+ * linker moves them. Jumps inside a module are
+ * pc-relative and need none.
+ */
+#define TMB_MAGIC "TMB"
+#define TMB_VERSION 3
+
+/* kinds of files */
+#define TMB_PROGRAM 0
+#define TMB_OBJECT 1
+
+typedef struct
+{
+    char magic[4]; /* TMB_MAGIC */
+    int version;   /* TMB_VERSION */
+    int kind;      /* TMB_PROGRAM or TMB_OBJECT */
+    int ninstr;
+    int dataBase;
+    int ndata;
+    int nglobals;
+    int nsyms;
+    int nrelocs;
+    int strsize;
+} TmbHeader;
+
+/* an instruction, laid out as tm's INSTRUCTION: the
+ * opcode numbered as in tm.c's OPCODE, then r and
+ * s,t (register-only) or d,s (all others)
+ */
+typedef struct
+{
+    int iop;
+    int iarg1;
+    int iarg2;
+    int iarg3;
+} TmbInstr;
+
+/* kinds of symbols */
+#define TMB_FUNC 0   /* a function entry at code location loc */
+#define TMB_VAR 1    /* a global variable at loc(gp) */
+#define TMB_EXTERN 2 /* a function of another module */
+
+typedef struct
+{
+    int kind;
+    int loc;
+    int name; /* offset in the strings */
+} TmbSymbol;
+
+/* kinds of relocations */
+#define TMB_RCALL 0   /* LDA pc,d(pc) at loc jumps to symbol sym */
+#define TMB_RGLOBAL 1 /* d(gp) at loc addresses a global */
+
+typedef struct
+{
+    int kind;
+    int loc;
+    int sym;
+} TmbReloc;
+
+/* the parts of a loaded file, pointing into its
+ * mapping
+ */
+typedef struct
+{
+    TmbHeader *header;
+    TmbInstr *instr;
+    int *data;
+    TmbSymbol *syms;
+    TmbReloc *relocs;
+    char *strings;
+} TmbImage;
+
+/* Function tmbLoad maps the .tmb or .tmo file
+ * name into memory and fills img with its parts;
+ * it returns FALSE, after printing a message, if
+ * the file cannot be read or is not in this
+ * version of the format
+ */
+int tmbLoad(char *name, TmbImage *img);
+
+/* the name of symbol k of a loaded file */
+#define tmbName(img, k) ((img)->strings + (img)->syms[k].name)
+
+#endif
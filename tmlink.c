@@ -0,0 +1,259 @@
+/****************************************************/
+/* File: tmlink.c                                   */
+/* Linker of relocatable TM objects (.tmo) into a   */
+/* TM program (.tmb), see tmfmt.h                   */
+/****************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tmfmt.h"
+
+#ifndef TRUE
+#define TRUE 1
+#endif
+#ifndef FALSE
+#define FALSE 0
+#endif
+
+/* the opcodes of the prelude, numbered as in tm.c */
+#define OP_HALT 0
+#define OP_LD 8
+#define OP_ST 9
+#define OP_LDA 11
+
+/* registers */
+#define PC 7
+#define MP 6
+#define AC 0
+#define AC1 1
+
+/* the prelude, which tiny leaves out of objects:
+ * LD mp,0(ac); ST ac,0(ac); LDA ac1,1(pc);
+ * LDA pc,main(pc); HALT
+ */
+#define PRELUDE 5
+#define MAIN_CALL 3
+
+/* one object and where its code and globals go */
+typedef struct
+{
+    char *name;
+    TmbImage img;
+    int codeBase;
+    int globalBase;
+} Module;
+
+static Module *modules;
+static int nmodules = 0;
+
+/* a symbol defined by a module, relocated */
+typedef struct
+{
+    int kind;
+    int loc;
+    char *name; /* in the mapping of its module */
+} Def;
+
+static Def *defs = NULL;
+static int ndefs = 0;
+
+static int errors = 0;
+
+/* Function lookup returns the index in defs of
+ * the symbol name of the given kind, or -1
+ */
+static int lookup(int kind, char *name)
+{
+    int k;
+    for (k = 0; k < ndefs; k++)
+        if (defs[k].kind == kind && strcmp(defs[k].name, name) == 0)
+            return k;
+    return -1;
+}
+
+/* Procedure define enters the symbols of module m
+ * at their final locations
+ */
+static void define(Module *m)
+{
+    TmbHeader *h = m->img.header;
+    int k;
+    for (k = 0; k < h->nsyms; k++)
+    {
+        TmbSymbol *s = &m->img.syms[k];
+        if (s->kind == TMB_EXTERN)
+            continue;
+        if (lookup(s->kind, tmbName(&m->img, k)) >= 0)
+        {
+            printf("%s: %s is defined twice\n", m->name, tmbName(&m->img, k));
+            errors++;
+            continue;
+        }
+        defs[ndefs].kind = s->kind;
+        defs[ndefs].loc = s->loc + (s->kind == TMB_FUNC ? m->codeBase : m->globalBase);
+        defs[ndefs].name = tmbName(&m->img, k);
+        ndefs++;
+    }
+}
+
+/* Procedure relocate copies the code of module m
+ * to code and applies its relocations
+ */
+static void relocate(Module *m, TmbInstr *code)
+{
+    TmbHeader *h = m->img.header;
+    TmbInstr *i;
+    int k, f;
+    memcpy(code + m->codeBase, m->img.instr, h->ninstr * sizeof(TmbInstr));
+    for (k = 0; k < h->nrelocs; k++)
+    {
+        TmbReloc *r = &m->img.relocs[k];
+        if (r->loc < 0 || r->loc >= h->ninstr)
+        {
+            printf("%s: bad relocation\n", m->name);
+            errors++;
+            continue;
+        }
+        i = &code[m->codeBase + r->loc];
+        switch (r->kind)
+        {
+        case TMB_RGLOBAL:
+            i->iarg2 += m->globalBase;
+            break;
+        case TMB_RCALL:
+            if (r->sym < 0 || r->sym >= h->nsyms)
+                f = -1;
+            else
+                f = lookup(TMB_FUNC, tmbName(&m->img, r->sym));
+            if (f < 0)
+            {
+                printf("%s: undefined function %s\n", m->name,
+                       r->sym >= 0 && r->sym < h->nsyms ? tmbName(&m->img, r->sym) : "?");
+                errors++;
+                break;
+            }
+            i->iarg2 = defs[f].loc - (m->codeBase + r->loc + 1);
+            break;
+        default:
+            printf("%s: bad relocation\n", m->name);
+            errors++;
+            break;
+        }
+    }
+}
+
+static void setInstr(TmbInstr *i, int op, int r, int a2, int a3)
+{
+    i->iop = op;
+    i->iarg1 = r;
+    i->iarg2 = a2;
+    i->iarg3 = a3;
+}
+
+/* Function writeProgram writes the linked program
+ * of n instructions to filename
+ */
+static int writeProgram(char *filename, TmbInstr *code, int n, int nglobals)
+{
+    TmbHeader h;
+    TmbSymbol sym;
+    int k;
+    FILE *out = fopen(filename, "wb");
+    if (out == NULL)
+        return FALSE;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, TMB_MAGIC, sizeof(h.magic));
+    h.version = TMB_VERSION;
+    h.kind = TMB_PROGRAM;
+    h.ninstr = n;
+    h.nglobals = nglobals;
+    h.nsyms = ndefs;
+    for (k = 0; k < ndefs; k++)
+        h.strsize += strlen(defs[k].name) + 1;
+    fwrite(&h, sizeof(h), 1, out);
+    fwrite(code, sizeof(TmbInstr), n, out);
+    for (k = 0, sym.name = 0; k < ndefs; k++)
+    {
+        sym.kind = defs[k].kind;
+        sym.loc = defs[k].loc;
+        fwrite(&sym, sizeof(sym), 1, out);
+        sym.name += strlen(defs[k].name) + 1;
+    }
+    for (k = 0; k < ndefs; k++)
+        fwrite(defs[k].name, 1, strlen(defs[k].name) + 1, out);
+    return fclose(out) == 0;
+}
+
+int main(int argc, char *argv[])
+{
+    char *outfile = NULL;
+    TmbInstr *code;
+    int k, loc, nsyms = 0, entry;
+    modules = malloc(argc * sizeof(Module));
+    for (k = 1; k < argc; k++)
+    {
+        if (strcmp(argv[k], "-o") == 0 && k + 1 < argc)
+            outfile = argv[++k];
+        else
+            modules[nmodules++].name = argv[k];
+    }
+    if (nmodules == 0)
+    {
+        fprintf(stderr, "usage: %s [-o program.tmb] object.tmo ...\n", argv[0]);
+        exit(1);
+    }
+    if (outfile == NULL)
+    {
+        int len = strcspn(modules[0].name, ".");
+        outfile = calloc(len + 5, 1);
+        strncpy(outfile, modules[0].name, len);
+        strcat(outfile, ".tmb");
+    }
+    /* lay the modules out after the prelude */
+    loc = PRELUDE;
+    for (k = 0; k < nmodules; k++)
+    {
+        Module *m = &modules[k];
+        if (!tmbLoad(m->name, &m->img))
+            exit(1);
+        if (m->img.header->kind != TMB_OBJECT)
+        {
+            printf("%s: not an object file\n", m->name);
+            exit(1);
+        }
+        m->codeBase = loc;
+        m->globalBase = k == 0 ? 0 : modules[k - 1].globalBase +
+                                         modules[k - 1].img.header->nglobals;
+        loc += m->img.header->ninstr;
+        nsyms += m->img.header->nsyms;
+    }
+    defs = malloc((nsyms + 1) * sizeof(Def));
+    for (k = 0; k < nmodules; k++)
+        define(&modules[k]);
+    code = malloc(loc * sizeof(TmbInstr));
+    for (k = 0; k < nmodules; k++)
+        relocate(&modules[k], code);
+    entry = lookup(TMB_FUNC, "main");
+    if (entry < 0)
+    {
+        printf("no function main\n");
+        errors++;
+    }
+    if (errors > 0)
+        exit(1);
+    setInstr(&code[0], OP_LD, MP, 0, AC);
+    setInstr(&code[1], OP_ST, AC, 0, AC);
+    setInstr(&code[2], OP_LDA, AC1, 1, PC);
+    setInstr(&code[MAIN_CALL], OP_LDA, PC, defs[entry].loc - (MAIN_CALL + 1), PC);
+    setInstr(&code[4], OP_HALT, 0, 0, 0);
+    k = nmodules - 1;
+    if (!writeProgram(outfile, code, loc,
+                      modules[k].globalBase + modules[k].img.header->nglobals))
+    {
+        printf("Unable to write %s\n", outfile);
+        exit(1);
+    }
+    return 0;
+}
@@ -0,0 +1,97 @@
+/****************************************************/
+/* File: tmload.c                                   */
+/* Loader of binary TM programs and objects         */
+/* (see tmfmt.h)                                    */
+/****************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "tmfmt.h"
+
+#ifndef TRUE
+#define TRUE 1
+#endif
+#ifndef FALSE
+#define FALSE 0
+#endif
+
+static int loadError(char *name, char *msg)
+{
+    printf("file '%s': %s\n", name, msg);
+    return FALSE;
+}
+
+/* Function validNames returns whether the name
+ * of every symbol of img ends within its strings
+ */
+static int validNames(TmbImage *img)
+{
+    TmbHeader *h = img->header;
+    int k;
+    for (k = 0; k < h->nsyms; k++)
+        if (img->syms[k].name < 0 || img->syms[k].name >= h->strsize ||
+            memchr(tmbName(img, k), '\0', h->strsize - img->syms[k].name) == NULL)
+            return FALSE;
+    return TRUE;
+}
+
+/* Function tmbLoad maps the .tmb or .tmo file
+ * name into memory and fills img with its parts;
+ * it returns FALSE, after printing a message, if
+ * the file cannot be read or is not in this
+ * version of the format
+ */
+int tmbLoad(char *name, TmbImage *img)
+{
+    struct stat st;
+    char *base, *msg = NULL;
+    TmbHeader *h;
+    long size;
+    int fd = open(name, O_RDONLY);
+    if (fd < 0)
+        return loadError(name, "not found");
+    if (fstat(fd, &st) < 0 || st.st_size < (long)sizeof(TmbHeader))
+    {
+        close(fd);
+        return loadError(name, "not a TM program");
+    }
+    base = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED)
+        return loadError(name, "cannot be mapped");
+    h = (TmbHeader *)base;
+    size = sizeof(TmbHeader) + (long)h->ninstr * sizeof(TmbInstr) +
+           (long)h->ndata * sizeof(int) + (long)h->nsyms * sizeof(TmbSymbol) +
+           (long)h->nrelocs * sizeof(TmbReloc) + h->strsize;
+    if (memcmp(h->magic, TMB_MAGIC, sizeof(h->magic)) != 0)
+        msg = "not a TM program";
+    else if (h->version != TMB_VERSION)
+        msg = "wrong version of the TM format";
+    else if (h->ninstr < 0 || h->ndata < 0 || h->nsyms < 0 || h->dataBase < 0 ||
+             h->nglobals < 0 || h->nrelocs < 0 || h->strsize < 0)
+        msg = "corrupt header";
+    else if (size > st.st_size)
+        msg = "truncated";
+    if (msg == NULL)
+    {
+        img->header = h;
+        img->instr = (TmbInstr *)(h + 1);
+        img->data = (int *)(img->instr + h->ninstr);
+        img->syms = (TmbSymbol *)(img->data + h->ndata);
+        img->relocs = (TmbReloc *)(img->syms + h->nsyms);
+        img->strings = (char *)(img->relocs + h->nrelocs);
+        if (!validNames(img))
+            msg = "corrupt symbol table";
+    }
+    if (msg != NULL)
+    {
+        munmap(base, st.st_size);
+        return loadError(name, msg);
+    }
+    return TRUE;
+}
@@ -0,0 +1,304 @@
+/****************************************************/
+/* File: unroll.c                                   */
+/* Unrolling of counted while loops for the C--     */
+/* compiler                                         */
+/****************************************************/
+
+#include <limits.h>
+#include "globals.h"
+#include "util.h"
+#include "unroll.h"
+
+static int budget = 0; /* syntax tree nodes unrolling may still add */
+static int factor = UNROLL_FACTOR;
+static int unrolled = 0;
+
+static int countNodes(TreeNode *t)
+{
+    int n = 0, i;
+    for (; t != NULL; t = t->sibling)
+    {
+        n++;
+        for (i = 0; i < MAXCHILDREN; i++)
+            n += countNodes(t->child[i]);
+    }
+    return n;
+}
+
+/* Function assignments returns the number of
+ * assignments to decl in the tree t
+ */
+static int assignments(TreeNode *t, TreeNode *decl)
+{
+    int n = 0, i;
+    for (; t != NULL; t = t->sibling)
+    {
+        if (t->nodekind == StmtK && t->kind.stmt == AssignK && t->decl == decl)
+            n++;
+        for (i = 0; i < MAXCHILDREN; i++)
+            n += assignments(t->child[i], decl);
+    }
+    return n;
+}
+
+static int hasCall(TreeNode *t)
+{
+    int i;
+    for (; t != NULL; t = t->sibling)
+    {
+        if (t->nodekind == ExpK && t->kind.exp == CallK)
+            return TRUE;
+        for (i = 0; i < MAXCHILDREN; i++)
+            if (hasCall(t->child[i]))
+                return TRUE;
+    }
+    return FALSE;
+}
+
+static int isConst(TreeNode *t)
+{
+    return t != NULL && t->nodekind == ExpK && t->kind.exp == ConstK;
+}
+
+static int isVar(TreeNode *t, TreeNode *decl)
+{
+    return t != NULL && t->nodekind == ExpK && t->kind.exp == IdK && t->decl == decl;
+}
+
+static TreeNode *newConst(int val, int lineno)
+{
+    TreeNode *c = newExpNode(ConstK);
+    c->attr.val = val;
+    c->type = Integer;
+    c->lineno = lineno;
+    return c;
+}
+
+/* Function stepOf returns the constant c > 0 if
+ * the last statement of the body of the while
+ * loop t is i = i + c, where i is the variable the
+ * test compares, and 0 otherwise
+ */
+static int stepOf(TreeNode *t)
+{
+    TreeNode *test = t->child[0], *body = t->child[1], *last, *e;
+    TreeNode *i, *n;
+    if (test == NULL || test->nodekind != ExpK || test->kind.exp != OpK ||
+        (test->attr.op != LT && test->attr.op != LE))
+        return 0;
+    i = test->child[0];
+    n = test->child[1];
+    if (i == NULL || i->nodekind != ExpK || i->kind.exp != IdK ||
+        i->decl == NULL || i->decl->scope == 0)
+        return 0;
+    if (!isConst(n))
+    {
+        /* the bound must not change in the loop */
+        if (n == NULL || n->nodekind != ExpK || n->kind.exp != IdK || n->decl == NULL ||
+            assignments(body, n->decl) > 0 || (n->decl->scope == 0 && hasCall(body)))
+            return 0;
+    }
+    last = body;
+    if (body != NULL && body->nodekind == StmtK && body->kind.stmt == CompoundK)
+        for (last = body->child[1]; last != NULL && last->sibling != NULL; last = last->sibling)
+            ;
+    if (last == NULL || last->nodekind != StmtK || last->kind.stmt != AssignK ||
+        last->decl != i->decl || assignments(body, i->decl) != 1)
+        return 0;
+    e = last->child[0];
+    if (e == NULL || e->nodekind != ExpK || e->kind.exp != OpK || e->attr.op != PLUS)
+        return 0;
+    if (isVar(e->child[0], i->decl) && isConst(e->child[1]) && e->child[1]->attr.val > 0)
+        return e->child[1]->attr.val;
+    if (isVar(e->child[1], i->decl) && isConst(e->child[0]) && e->child[0]->attr.val > 0)
+        return e->child[0]->attr.val;
+    return 0;
+}
+
+/* Function copies returns n copies of the
+ * statement body chained as siblings
+ */
+static TreeNode *copies(TreeNode *body, int n)
+{
+    TreeNode *first = NULL, **link = &first;
+    int k;
+    for (k = 0; k < n; k++)
+    {
+        *link = copyTree(body);
+        link = &(*link)->sibling;
+    }
+    return first;
+}
+
+/* Procedure unrollFully replaces the loop t by
+ * trips copies of its body
+ */
+static void unrollFully(TreeNode *t, int trips)
+{
+    TreeNode *body = t->child[1];
+    if (TraceOpt)
+        fprintf(listing, "loop at line %d unrolled fully, %d copies\n", t->lineno, trips);
+    t->kind.stmt = CompoundK;
+    t->child[0] = NULL;
+    t->child[1] = copies(body, trips);
+    t->child[2] = NULL;
+}
+
+/* Procedure unrollBy turns the loop t, while
+ * (i < n) body with i = i + step last in body,
+ * into
+ *
+ *     while (i < n)
+ *         if (i < n - ahead) { body ... body }
+ *         else body
+ *
+ * with factor copies of the body and ahead =
+ * (factor-1)*step, so the copies run while at
+ * least factor iterations remain. The inner test
+ * comes after i < n, so i - n is negative and
+ * i - (n - ahead), which TM computes as
+ * (i - n) + ahead, cannot overflow. When the trip
+ * count trips is known to be a multiple of factor
+ * the copies need no test
+ */
+static void unrollBy(TreeNode *t, int step, int trips)
+{
+    TreeNode *test = t->child[0], *body = t->child[1];
+    TreeNode *cond, *bound, *block;
+    int ahead = (factor - 1) * step;
+    if (TraceOpt)
+        fprintf(listing, "loop at line %d unrolled by %d\n", t->lineno, factor);
+    block = newStmtNode(CompoundK);
+    block->lineno = t->lineno;
+    block->child[1] = copies(body, factor);
+    if (trips >= 0 && trips % factor == 0)
+    {
+        t->child[1] = block;
+        return;
+    }
+    bound = newExpNode(OpK);
+    bound->attr.op = MINUS;
+    bound->type = Integer;
+    bound->lineno = t->lineno;
+    bound->child[0] = copyTree(test->child[1]);
+    bound->child[1] = newConst(ahead, t->lineno);
+    cond = newExpNode(OpK);
+    *cond = *test;
+    cond->sibling = NULL;
+    cond->child[0] = copyTree(test->child[0]);
+    cond->child[1] = bound;
+    t->child[1] = newStmtNode(SelectionK);
+    t->child[1]->lineno = t->lineno;
+    t->child[1]->child[0] = cond;
+    t->child[1]->child[1] = block;
+    t->child[1]->child[2] = body;
+}
+
+/* Function fitsAhead returns TRUE if the loop t
+ * with step step can run factor copies at a time:
+ * (factor-1)*step does not overflow and neither
+ * does a constant bound less it
+ */
+static int fitsAhead(TreeNode *t, int step)
+{
+    TreeNode *n = t->child[0]->child[1];
+    if (step > INT_MAX / (factor - 1))
+        return FALSE;
+    return !isConst(n) || n->attr.val >= INT_MIN + (factor - 1) * step;
+}
+
+/* Function tripCount returns the number of times
+ * the loop t with step step runs when the
+ * statement prev just before it sets the loop
+ * variable to a constant and the bound is a
+ * constant, and -1 otherwise
+ */
+static int tripCount(TreeNode *t, TreeNode *prev, int step)
+{
+    TreeNode *test = t->child[0];
+    int from, to;
+    if (prev == NULL || prev->nodekind != StmtK || prev->kind.stmt != AssignK ||
+        prev->decl != test->child[0]->decl || !isConst(prev->child[0]) ||
+        !isConst(test->child[1]))
+        return -1;
+    from = prev->child[0]->attr.val;
+    to = test->child[1]->attr.val;
+    if (test->attr.op == LE)
+    {
+        if (to == 2147483647)
+            return -1;
+        to++;
+    }
+    if (to <= from)
+        return 0;
+    if ((double)to - from > 1000000.0)
+        return -1;
+    return (to - from - 1) / step + 1;
+}
+
+static void unrollStmts(TreeNode *t);
+
+/* Procedure unrollStmt unrolls the loops inside
+ * statement t, innermost first, then t itself if
+ * it is a counted loop; prev is the statement
+ * before t or NULL
+ */
+static void unrollStmt(TreeNode *t, TreeNode *prev)
+{
+    int step, trips, size;
+    switch (t->kind.stmt)
+    {
+    case CompoundK:
+        unrollStmts(t->child[1]);
+        return;
+    case SelectionK:
+        unrollStmts(t->child[1]);
+        unrollStmts(t->child[2]);
+        return;
+    case FuncDeclarationK:
+        unrollStmts(t->child[1]);
+        return;
+    case WhileK:
+        unrollStmts(t->child[1]);
+        break;
+    default:
+        return;
+    }
+    step = stepOf(t);
+    if (step == 0)
+        return;
+    size = countNodes(t->child[1]);
+    trips = tripCount(t, prev, step);
+    if (trips > 0 && trips <= FULL_UNROLL && (trips - 1) * size <= budget)
+    {
+        budget -= (trips - 1) * size;
+        unrollFully(t, trips);
+        unrolled++;
+    }
+    else if (factor > 1 && (trips < 0 || trips >= factor) && factor * size <= budget &&
+             fitsAhead(t, step))
+    {
+        budget -= factor * size;
+        unrollBy(t, step, trips);
+        unrolled++;
+    }
+}
+
+static void unrollStmts(TreeNode *t)
+{
+    TreeNode *prev = NULL;
+    for (; t != NULL; prev = t, t = t->sibling)
+        if (t->nodekind == StmtK)
+            unrollStmt(t, prev);
+}
+
+int unrollLoops(TreeNode *syntaxTree, int n)
+{
+    factor = n;
+    unrolled = 0;
+    budget = CODE_LIMIT / 2 / NODE_COST - countNodes(syntaxTree);
+    if (TraceOpt)
+        fprintf(listing, "\nUnrolling loops...\n");
+    unrollStmts(syntaxTree);
+    return unrolled;
+}
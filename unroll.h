@@ -0,0 +1,42 @@
+/****************************************************/
+/* File: unroll.h                                   */
+/* Unrolling of counted while loops for the C--     */
+/* compiler                                         */
+/****************************************************/
+
+#ifndef _UNROLL_H_
+#define _UNROLL_H_
+
+/* UNROLL_FACTOR = the default number of copies of
+ * the body in an unrolled loop
+ */
+#define UNROLL_FACTOR 4
+
+/* FULL_UNROLL = the most iterations a loop with a
+ * constant trip count may have to be replaced by
+ * copies of its body
+ */
+#define FULL_UNROLL 8
+
+/* CODE_LIMIT = the instruction memory of TM
+ * (IADDR_SIZE in tm.c); unrolling stops before
+ * the estimated code, at NODE_COST instructions
+ * per syntax tree node, would fill half of it
+ */
+#define CODE_LIMIT 1024
+#define NODE_COST 3
+
+/* Function unrollLoops unrolls the loops
+ * while (i < n) or while (i <= n) whose body ends
+ * with i = i + c (c > 0, i a local not assigned
+ * elsewhere in the body, n a constant or a
+ * variable the body does not change): to run
+ * factor copies of the body per test while that
+ * many iterations remain and one otherwise, or
+ * completely when i was just set to a constant
+ * and at most FULL_UNROLL iterations run; it
+ * returns the number of loops unrolled
+ */
+int unrollLoops(TreeNode *syntaxTree, int factor);
+
+#endif
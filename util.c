@@ -123,6 +123,11 @@ TreeNode *newStmtNode(StmtKind kind)
         t->nodekind = StmtK;
         t->kind.stmt = kind;
         t->lineno = lineno;
+        t->decl = NULL;
+        t->scope = 0;
+        t->memloc = 0;
+        t->regs = 1;
+        t->calls = FALSE;
     }
     return t;
 }
@@ -140,6 +145,11 @@ TreeNode *newNullStmtNode()
         t->sibling = NULL;
         t->nodekind = StmtK;
         t->lineno = lineno;
+        t->decl = NULL;
+        t->scope = 0;
+        t->memloc = 0;
+        t->regs = 1;
+        t->calls = FALSE;
     }
     return t;
 }
@@ -162,6 +172,11 @@ TreeNode *newExpNode(ExpKind kind)
         t->kind.exp = kind;
         t->lineno = lineno;
         t->type = Void;
+        t->decl = NULL;
+        t->scope = 0;
+        t->memloc = 0;
+        t->regs = 1;
+        t->calls = FALSE;
     }
     return t;
 }
@@ -180,6 +195,11 @@ TreeNode *newNullExpNode()
         t->nodekind = ExpK;
         t->lineno = lineno;
         t->type = Void;
+        t->decl = NULL;
+        t->scope = 0;
+        t->memloc = 0;
+        t->regs = 1;
+        t->calls = FALSE;
     }
     return t;
 }
@@ -202,6 +222,132 @@ char *copyString(char *s)
     return t;
 }
 
+/* Function paramCount returns the number of
+ * parameters in the ParamK list of a function
+ * declaration; a single void parameter means none
+ */
+int paramCount(TreeNode *t)
+{
+    int n = 0;
+    if (t != NULL && t->sibling == NULL && t->type == Void)
+        return 0;
+    for (; t != NULL; t = t->sibling)
+        n++;
+    return n;
+}
+
+/* Procedure labelTree labels every node of the
+ * tree t, bottom-up, with whether it contains a
+ * call and every OpK node with its Sethi-Ullman
+ * number
+ */
+void labelTree(TreeNode *t)
+{
+    int i, l, r;
+    for (; t != NULL; t = t->sibling)
+    {
+        t->calls = t->nodekind == ExpK && t->kind.exp == CallK;
+        for (i = 0; i < MAXCHILDREN; i++)
+        {
+            labelTree(t->child[i]);
+            if (t->child[i] != NULL && t->child[i]->calls)
+                t->calls = TRUE;
+        }
+        if (t->nodekind == ExpK && t->kind.exp == OpK)
+        {
+            l = regNeed(t->child[0]);
+            r = regNeed(t->child[1]);
+            t->regs = l == r ? l + 1 : l > r ? l : r;
+        }
+    }
+}
+
+/* Function containsCall returns TRUE if the
+ * expression contains a function call
+ */
+int containsCall(TreeNode *t)
+{
+    return t != NULL && t->calls;
+}
+
+/* Function regNeed returns the Sethi-Ullman
+ * number of an expression
+ */
+int regNeed(TreeNode *t)
+{
+    if (t == NULL || t->nodekind != ExpK || t->kind.exp != OpK)
+        return 1;
+    return t->regs;
+}
+
+/* Function heavierRight returns TRUE if the right
+ * operand of the OpK node t should go first
+ */
+int heavierRight(TreeNode *t)
+{
+    return regNeed(t->child[1]) > regNeed(t->child[0]) && !t->calls;
+}
+
+/* the declarations copied by copyTree and
+ * their copies
+ */
+static TreeNode **declFrom = NULL, **declTo = NULL;
+static int ndecls = 0, maxdecls = 0;
+
+static TreeNode *copyNodes(TreeNode *t)
+{
+    TreeNode *c;
+    int i;
+    if (t == NULL)
+        return NULL;
+    c = (TreeNode *)malloc(sizeof(TreeNode));
+    *c = *t;
+    if (t->nodekind == StmtK && t->kind.stmt == VarDeclarationK)
+    {
+        if (ndecls == maxdecls)
+        {
+            maxdecls = maxdecls ? 2 * maxdecls : 16;
+            declFrom = realloc(declFrom, maxdecls * sizeof(TreeNode *));
+            declTo = realloc(declTo, maxdecls * sizeof(TreeNode *));
+        }
+        declFrom[ndecls] = t;
+        declTo[ndecls++] = c;
+    }
+    for (i = 0; i < MAXCHILDREN; i++)
+        c->child[i] = copyNodes(t->child[i]);
+    c->sibling = copyNodes(t->sibling);
+    return c;
+}
+
+static void relink(TreeNode *t)
+{
+    int i;
+    for (; t != NULL; t = t->sibling)
+    {
+        for (i = 0; i < ndecls; i++)
+            if (t->decl != NULL && t->decl == declFrom[i])
+            {
+                t->decl = declTo[i];
+                break;
+            }
+        for (i = 0; i < MAXCHILDREN; i++)
+            relink(t->child[i]);
+    }
+}
+
+/* Function copyTree returns a copy of the tree t
+ * and its siblings, with the names declared in
+ * it relinked to the copied declarations
+ */
+TreeNode *copyTree(TreeNode *t)
+{
+    TreeNode *c;
+    ndecls = 0;
+    c = copyNodes(t);
+    relink(c);
+    return c;
+}
+
 /* Variable indentno is used by printTree to
  * store current number of spaces to indent
  */
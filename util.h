@@ -34,6 +34,47 @@ TreeNode * newNullExpNode();
  */
 char * copyString( char * );
 
+/* Function paramCount returns the number of
+ * parameters in the ParamK list of a function
+ * declaration; a single void parameter means none
+ */
+int paramCount( TreeNode * );
+
+/* Procedure labelTree labels every node of the
+ * tree, bottom-up, with whether it contains a
+ * call and every OpK node with its Sethi-Ullman
+ * number, so that the three functions below take
+ * constant time; it must run again after the
+ * tree changes
+ */
+void labelTree( TreeNode * );
+
+/* Function containsCall returns TRUE if the
+ * expression contains a function call
+ */
+int containsCall( TreeNode * );
+
+/* Function regNeed returns the Sethi-Ullman
+ * number of an expression: the registers needed
+ * to evaluate it without spilling when the
+ * heavier operand of every OpK goes first
+ */
+int regNeed( TreeNode * );
+
+/* Function heavierRight returns TRUE if the right
+ * operand of the OpK node should be evaluated
+ * first: it needs more registers and neither
+ * operand calls a function, so the order cannot
+ * be observed
+ */
+int heavierRight( TreeNode * );
+
+/* Function copyTree returns a copy of the tree t
+ * and its siblings; in the copy, names declared
+ * inside t refer to the copied declarations
+ */
+TreeNode * copyTree( TreeNode * );
+
 /* procedure printTree prints a syntax tree to the 
  * listing file using indentation to indicate subtrees
  */
@@ -0,0 +1,356 @@
+/****************************************************/
+/* File: x86gen.c                                   */
+/* x86-64 assembly generation from the IR for the   */
+/* C-- compiler                                     */
+/****************************************************/
+
+#include "globals.h"
+#include "ir.h"
+#include "regalloc.h"
+#include "x86gen.h"
+
+/* C-- functions and globals become the symbols
+ * cmm_<name>, so they cannot clash with the C
+ * library. Functions follow the System V calling
+ * convention: the first six arguments in edi, esi,
+ * edx, ecx, r8d and r9d, the others pushed right
+ * to left, the result in eax. The TM registers
+ * FIRST_REG .. LAST_REG of the register allocator
+ * become the callee-saved ebx, r12d and r13d, so
+ * nothing needs saving around calls; the other
+ * temporaries keep their frame word, 8 bytes each,
+ * below the saved registers. eax and ecx are
+ * scratch.
+ */
+
+static char *regNames[NUM_REGS] = {"%ebx", "%r12d", "%r13d"};
+static char *saveNames[NUM_REGS] = {"%rbx", "%r12", "%r13"};
+
+#define NARGREGS 6
+static char *argRegs[NARGREGS] = {"%edi", "%esi", "%edx", "%ecx", "%r8d", "%r9d"};
+
+/* the function being generated */
+static IrFunc *fn = NULL;
+
+/* registers pushed by its prologue */
+static int saved[NUM_REGS];
+static int nsaved = 0;
+
+/* the global names of the program */
+static IrProgram *prog = NULL;
+
+static int regOf(IrOperand o)
+{
+    if (o.kind == OpdTemp && fn->reg != NULL)
+        return fn->reg[o.val];
+    return -1;
+}
+
+static int slot(int t)
+{
+    return fn->slot != NULL ? fn->slot[t] : -1 - t;
+}
+
+/* Function operand writes the assembler form of o
+ * to buf and returns it
+ */
+static char *operand(IrOperand o, char *buf)
+{
+    int r = regOf(o);
+    if (o.kind == OpdConst)
+        sprintf(buf, "$%d", o.val);
+    else if (r >= 0)
+        sprintf(buf, "%s", regNames[r - FIRST_REG]);
+    else
+        sprintf(buf, "%d(%%rbp)", 8 * slot(o.val) - 8 * nsaved);
+    return buf;
+}
+
+static int inMemory(IrOperand o)
+{
+    return o.kind == OpdTemp && regOf(o) < 0;
+}
+
+/* Procedure load brings operand o into register r */
+static void load(char *r, IrOperand o)
+{
+    char a[40];
+    fprintf(code, "\tmovl\t%s, %s\n", operand(o, a), r);
+}
+
+/* Procedure store saves register r to dst, if
+ * there is one
+ */
+static void store(IrOperand dst, char *r)
+{
+    char d[40];
+    if (dst.kind == OpdTemp)
+        fprintf(code, "\tmovl\t%s, %s\n", r, operand(dst, d));
+}
+
+static char *condition(IrOp op)
+{
+    switch (op)
+    {
+    case IrLt: return "l";
+    case IrLe: return "le";
+    case IrGt: return "g";
+    case IrGe: return "ge";
+    case IrEq: return "e";
+    default: return "ne";
+    }
+}
+
+static void jumpTo(IrBlock *b, IrBlock *next)
+{
+    if (b != next)
+        fprintf(code, "\tjmp\t.Lcmm_%s_%d\n", fn->name, b->id);
+}
+
+/* Procedure genCall passes the arguments of call i
+ * in registers and on the stack, keeping rsp
+ * 16-byte aligned, and stores the result
+ */
+static void genCall(IrInstr *i)
+{
+    int nstack = i->nargs > NARGREGS ? i->nargs - NARGREGS : 0;
+    int pad = nstack % 2, k;
+    if (pad)
+        fprintf(code, "\tsubq\t$8, %%rsp\n");
+    for (k = i->nargs - 1; k >= NARGREGS; k--)
+    {
+        load("%eax", i->args[k]);
+        fprintf(code, "\tpushq\t%%rax\n");
+    }
+    for (k = 0; k < i->nargs && k < NARGREGS; k++)
+        load(argRegs[k], i->args[k]);
+    fprintf(code, "\tcall\tcmm_%s\n", i->callee);
+    if (nstack + pad > 0)
+        fprintf(code, "\taddq\t$%d, %%rsp\n", 8 * (nstack + pad));
+    store(i->dst, "%eax");
+}
+
+static void genInstr(IrBlock *b, IrBlock *next, IrInstr *i)
+{
+    char a[40], d[40];
+    IrBlock *yes, *no;
+    IrOp cmp;
+    switch (i->op)
+    {
+    case IrNop:
+    case IrPhi:
+        break;
+    case IrMov:
+        if (i->dst.kind != OpdTemp)
+            break;
+        if (inMemory(i->dst) && inMemory(i->a))
+        {
+            load("%eax", i->a);
+            store(i->dst, "%eax");
+        }
+        else
+            fprintf(code, "\tmovl\t%s, %s\n", operand(i->a, a), operand(i->dst, d));
+        break;
+    case IrAdd:
+    case IrSub:
+    case IrMul:
+        load("%eax", i->a);
+        fprintf(code, "\t%s\t%s, %%eax\n",
+                i->op == IrAdd ? "addl" : i->op == IrSub ? "subl" : "imull",
+                operand(i->b, a));
+        store(i->dst, "%eax");
+        break;
+    case IrDiv:
+        load("%eax", i->a);
+        load("%ecx", i->b);
+        fprintf(code, "\tcltd\n\tidivl\t%%ecx\n");
+        store(i->dst, "%eax");
+        break;
+    case IrLt:
+    case IrLe:
+    case IrGt:
+    case IrGe:
+    case IrEq:
+    case IrNe:
+        load("%eax", i->a);
+        fprintf(code, "\tcmpl\t%s, %%eax\n", operand(i->b, a));
+        fprintf(code, "\tset%s\t%%al\n\tmovzbl\t%%al, %%eax\n", condition(i->op));
+        store(i->dst, "%eax");
+        break;
+    case IrLoad:
+        fprintf(code, "\tmovl\tcmm_%s(%%rip), %%eax\n", prog->globalNames[i->sym]);
+        store(i->dst, "%eax");
+        break;
+    case IrStore:
+        if (inMemory(i->a))
+        {
+            load("%eax", i->a);
+            fprintf(code, "\tmovl\t%%eax, cmm_%s(%%rip)\n", prog->globalNames[i->sym]);
+        }
+        else
+            fprintf(code, "\tmovl\t%s, cmm_%s(%%rip)\n", operand(i->a, a),
+                    prog->globalNames[i->sym]);
+        break;
+    case IrIn:
+        fprintf(code, "\tcall\tcmm_input\n");
+        store(i->dst, "%eax");
+        break;
+    case IrOut:
+        load("%edi", i->a);
+        fprintf(code, "\tcall\tcmm_output\n");
+        break;
+    case IrCall:
+        genCall(i);
+        break;
+    case IrJump:
+        jumpTo(b->succ[0], next);
+        break;
+    case IrBranch:
+        cmp = i->cmp;
+        yes = b->succ[0];
+        no = b->succ[1];
+        load("%eax", i->a);
+        fprintf(code, "\tcmpl\t%s, %%eax\n", operand(i->b, a));
+        if (yes == next)
+        {
+            cmp = irInvertCmp(cmp);
+            yes = no;
+            no = next;
+        }
+        fprintf(code, "\tj%s\t.Lcmm_%s_%d\n", condition(cmp), fn->name, yes->id);
+        jumpTo(no, next);
+        break;
+    case IrReturn:
+        if (i->a.kind != OpdNone)
+            load("%eax", i->a);
+        if (next != NULL)
+            fprintf(code, "\tjmp\t.Lcmm_%s_ret\n", fn->name);
+        break;
+    }
+}
+
+/* Procedure genFunc emits function f: a frame
+ * pointer, the callee-saved registers the
+ * allocator used, the frame words, and the
+ * parameters moved to where the allocator put them
+ */
+static void genFunc(IrFunc *f)
+{
+    int t, k, words = 0;
+    char d[40], s[40];
+    fn = f;
+    nsaved = 0;
+    for (k = 0; k < NUM_REGS; k++)
+        saved[k] = FALSE;
+    for (t = 0; t < f->ntemps; t++)
+        if (regOf(irTemp(t)) >= 0)
+            saved[regOf(irTemp(t)) - FIRST_REG] = TRUE;
+        else if (-slot(t) > words)
+            words = -slot(t);
+    for (k = 0; k < NUM_REGS; k++)
+        nsaved += saved[k];
+    /* rsp is 16-byte aligned after pushing rbp */
+    if ((nsaved + words) % 2 != 0)
+        words++;
+    fprintf(code, "\n\t.globl\tcmm_%s\n\t.type\tcmm_%s, @function\n", f->name, f->name);
+    fprintf(code, "cmm_%s:\n", f->name);
+    fprintf(code, "\tpushq\t%%rbp\n\tmovq\t%%rsp, %%rbp\n");
+    for (k = 0; k < NUM_REGS; k++)
+        if (saved[k])
+            fprintf(code, "\tpushq\t%s\n", saveNames[k]);
+    if (words > 0)
+        fprintf(code, "\tsubq\t$%d, %%rsp\n", 8 * words);
+    for (k = 0; k < f->nparams; k++)
+    {
+        if (k < NARGREGS)
+            strcpy(s, argRegs[k]);
+        else
+            sprintf(s, "%d(%%rbp)", 16 + 8 * (k - NARGREGS));
+        if (k >= NARGREGS && inMemory(irTemp(k)))
+        {
+            fprintf(code, "\tmovl\t%s, %%eax\n", s);
+            strcpy(s, "%eax");
+        }
+        fprintf(code, "\tmovl\t%s, %s\n", s, operand(irTemp(k), d));
+    }
+    for (k = 0; k < f->nblocks; k++)
+    {
+        IrBlock *b = f->blocks[k];
+        IrBlock *next = k + 1 < f->nblocks ? f->blocks[k + 1] : NULL;
+        IrInstr *i;
+        fprintf(code, ".Lcmm_%s_%d:\n", f->name, b->id);
+        for (i = b->first; i != NULL; i = i->next)
+            genInstr(b, next, i);
+    }
+    fprintf(code, ".Lcmm_%s_ret:\n", f->name);
+    if (nsaved > 0)
+        fprintf(code, "\tleaq\t%d(%%rbp), %%rsp\n", -8 * nsaved);
+    for (k = NUM_REGS - 1; k >= 0; k--)
+        if (saved[k])
+            fprintf(code, "\tpopq\t%s\n", saveNames[k]);
+    fprintf(code, "\tleave\n\tret\n");
+    fprintf(code, "\t.size\tcmm_%s, .-cmm_%s\n", f->name, f->name);
+}
+
+/* Procedure genRuntime emits input and output on
+ * top of scanf and printf, and a C main that runs
+ * the C-- one
+ */
+static void genRuntime(int hasMain)
+{
+    fprintf(code, "\n\t.section\t.rodata\n");
+    fprintf(code, ".Lcmm_fmt_in:\n\t.string\t\"%%d\"\n");
+    fprintf(code, ".Lcmm_fmt_out:\n\t.string\t\"%%d\\n\"\n");
+    fprintf(code, "\n\t.text\n");
+    fprintf(code, "cmm_input:\n");
+    fprintf(code, "\tsubq\t$24, %%rsp\n");
+    fprintf(code, "\tmovl\t$0, 12(%%rsp)\n");
+    fprintf(code, "\tleaq\t12(%%rsp), %%rsi\n");
+    fprintf(code, "\tleaq\t.Lcmm_fmt_in(%%rip), %%rdi\n");
+    fprintf(code, "\txorl\t%%eax, %%eax\n");
+    fprintf(code, "\tcall\tscanf@PLT\n");
+    fprintf(code, "\tmovl\t12(%%rsp), %%eax\n");
+    fprintf(code, "\taddq\t$24, %%rsp\n\tret\n");
+    fprintf(code, "cmm_output:\n");
+    fprintf(code, "\tsubq\t$8, %%rsp\n");
+    fprintf(code, "\tmovl\t%%edi, %%esi\n");
+    fprintf(code, "\tleaq\t.Lcmm_fmt_out(%%rip), %%rdi\n");
+    fprintf(code, "\txorl\t%%eax, %%eax\n");
+    fprintf(code, "\tcall\tprintf@PLT\n");
+    fprintf(code, "\taddq\t$8, %%rsp\n\tret\n");
+    if (hasMain)
+    {
+        fprintf(code, "\n\t.globl\tmain\n\t.type\tmain, @function\n");
+        fprintf(code, "main:\n");
+        fprintf(code, "\tsubq\t$8, %%rsp\n");
+        fprintf(code, "\tcall\tcmm_main\n");
+        fprintf(code, "\txorl\t%%eax, %%eax\n");
+        fprintf(code, "\taddq\t$8, %%rsp\n\tret\n");
+    }
+}
+
+/* Procedure genX86 writes the program p as x86-64
+ * GNU assembler to the code file
+ */
+void genX86(IrProgram *p, char *asmfile)
+{
+    IrFunc *f;
+    int k, hasMain = FALSE;
+    prog = p;
+    fprintf(code, "# C-- Compilation to x86-64\n# File: %s\n", asmfile);
+    if (p->nglobals > 0)
+    {
+        fprintf(code, "\n\t.bss\n\t.align\t4\n");
+        for (k = 0; k < p->nglobals; k++)
+            fprintf(code, "cmm_%s:\n\t.zero\t4\n", p->globalNames[k]);
+    }
+    fprintf(code, "\n\t.text\n");
+    for (f = p->funcs; f != NULL; f = f->next)
+    {
+        genFunc(f);
+        if (strcmp(f->name, "main") == 0)
+            hasMain = TRUE;
+    }
+    genRuntime(hasMain);
+    fprintf(code, "\n\t.section\t.note.GNU-stack,\"\",@progbits\n");
+}
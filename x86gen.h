@@ -0,0 +1,21 @@
+/****************************************************/
+/* File: x86gen.h                                   */
+/* x86-64 assembly generation from the IR for the   */
+/* C-- compiler                                     */
+/****************************************************/
+
+#ifndef _X86GEN_H_
+#define _X86GEN_H_
+
+#include "ir.h"
+
+/* Procedure genX86 writes the IR program p, after
+ * register allocation, to the code file as x86-64
+ * GNU assembler for the System V ABI, with input,
+ * output and a C main calling the C-- one; the
+ * second parameter (asmfile) is the file name,
+ * printed as a comment
+ */
+void genX86(IrProgram *p, char *asmfile);
+
+#endif